@@ -0,0 +1,288 @@
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include "board.h"
+
+namespace {
+
+#ifdef GO_BITBOARD_BACKEND
+const char* const BACKEND = "bitboard";
+#else
+const char* const BACKEND = "mailbox";
+#endif
+
+// The rules written out with plain flood fills and whole-board copies: slow
+// and obviously right, so Board can be checked against it
+template <int SIZE>
+struct ReferenceBoard {
+    int cells[SIZE][SIZE] = {};
+    std::optional<Position> ko;
+    
+    bool on_board(int x, int y) const {
+        return x >= 0 && x < SIZE && y >= 0 && y < SIZE;
+    }
+    
+    // Stones of the chain at (x, y) and its distinct liberties
+    void chain(int x, int y, std::vector<Position>& stones, std::vector<Position>& liberties) const {
+        stones.clear();
+        liberties.clear();
+        bool seen[SIZE][SIZE] = {};
+        std::vector<Position> stack = {Position(x, y)};
+        seen[y][x] = true;
+        while (!stack.empty()) {
+            Position pos = stack.back();
+            stack.pop_back();
+            stones.push_back(pos);
+            const Position neighbors[4] = {Position(pos.x - 1, pos.y), Position(pos.x + 1, pos.y),
+                                           Position(pos.x, pos.y - 1), Position(pos.x, pos.y + 1)};
+            for (const auto& n : neighbors) {
+                if (!on_board(n.x, n.y) || seen[n.y][n.x]) {
+                    continue;
+                }
+                if (cells[n.y][n.x] == EMPTY) {
+                    seen[n.y][n.x] = true;
+                    liberties.push_back(n);
+                } else if (cells[n.y][n.x] == cells[y][x]) {
+                    seen[n.y][n.x] = true;
+                    stack.push_back(n);
+                }
+            }
+        }
+    }
+    
+    // Plays the move if it is legal and returns the stones it captured in
+    // captured. A move capturing exactly one stone makes that point the ko.
+    bool play(int x, int y, int color, std::vector<Position>& captured) {
+        if (!on_board(x, y) || cells[y][x] != EMPTY || (ko && *ko == Position(x, y))) {
+            return false;
+        }
+        ReferenceBoard after = *this;
+        after.cells[y][x] = color;
+        captured.clear();
+        std::vector<Position> stones, liberties;
+        const Position neighbors[4] = {Position(x - 1, y), Position(x + 1, y), Position(x, y - 1), Position(x, y + 1)};
+        for (const auto& n : neighbors) {
+            if (on_board(n.x, n.y) && after.cells[n.y][n.x] == get_opponent(color)) {
+                after.chain(n.x, n.y, stones, liberties);
+                if (liberties.empty()) {
+                    for (const auto& stone : stones) {
+                        after.cells[stone.y][stone.x] = EMPTY;
+                        captured.push_back(stone);
+                    }
+                }
+            }
+        }
+        after.chain(x, y, stones, liberties);
+        if (liberties.empty()) {
+            return false;   // suicide
+        }
+        after.ko = captured.size() == 1 ? std::optional<Position>(captured[0]) : std::nullopt;
+        *this = after;
+        return true;
+    }
+    
+    bool is_valid_move(int x, int y, int color) const {
+        ReferenceBoard copy = *this;
+        std::vector<Position> captured;
+        return copy.play(x, y, color, captured);
+    }
+    
+    int territory_owner(int x, int y) const {
+        if (cells[y][x] != EMPTY) {
+            return EMPTY;
+        }
+        bool seen[SIZE][SIZE] = {};
+        bool black = false;
+        bool white = false;
+        std::vector<Position> stack = {Position(x, y)};
+        seen[y][x] = true;
+        while (!stack.empty()) {
+            Position pos = stack.back();
+            stack.pop_back();
+            const Position neighbors[4] = {Position(pos.x - 1, pos.y), Position(pos.x + 1, pos.y),
+                                           Position(pos.x, pos.y - 1), Position(pos.x, pos.y + 1)};
+            for (const auto& n : neighbors) {
+                if (!on_board(n.x, n.y)) {
+                    continue;
+                }
+                int cell = cells[n.y][n.x];
+                black |= cell == BLACK;
+                white |= cell == WHITE;
+                if (cell == EMPTY && !seen[n.y][n.x]) {
+                    seen[n.y][n.x] = true;
+                    stack.push_back(n);
+                }
+            }
+        }
+        return black && !white ? BLACK : white && !black ? WHITE : EMPTY;
+    }
+};
+
+bool same_points(std::vector<Position> a, std::vector<Position> b) {
+    auto order = [](const Position& p, const Position& q) { return p.y != q.y ? p.y < q.y : p.x < q.x; };
+    std::sort(a.begin(), a.end(), order);
+    std::sort(b.begin(), b.end(), order);
+    return a == b;
+}
+
+// Compares everything Board answers about the position, and the bitboard
+// queries on its stones, with the reference; returns the first difference,
+// or an empty string
+template <int SIZE>
+std::string compare(const Board<SIZE>& board, const ReferenceBoard<SIZE>& reference) {
+    std::vector<Position> stones, liberties, group;
+    Position found[8];
+    typename Board<SIZE>::Bits bits[2] = {board.get_stones(BLACK), board.get_stones(WHITE)};
+    typename Board<SIZE>::Bits empty = all_points<SIZE>() - (bits[0] | bits[1]);
+    typename Board<SIZE>::Bits area[2];
+    territory(bits[0], bits[1], area[0], area[1]);
+    Board<SIZE> rebuilt;
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            std::string at = " at (" + std::to_string(x) + ", " + std::to_string(y) + ")";
+            int color = reference.cells[y][x];
+            if (board.get(x, y) != color) {
+                return "stone" + at;
+            }
+            if (bits[0].test(x, y) != (color == BLACK) || bits[1].test(x, y) != (color == WHITE)) {
+                return "get_stones" + at;
+            }
+            for (int c : {BLACK, WHITE}) {
+                if (board.is_valid_move(x, y, c) != reference.is_valid_move(x, y, c)) {
+                    return "is_valid_move for " + std::string(c == BLACK ? "black" : "white") + at;
+                }
+            }
+            if (color == EMPTY) {
+                int owner = reference.territory_owner(x, y);
+                if (board.get_territory_owner(x, y) != owner) {
+                    return "get_territory_owner" + at;
+                }
+                if (area[0].test(x, y) != (owner == BLACK) || area[1].test(x, y) != (owner == WHITE)) {
+                    return "territory()" + at;
+                }
+                continue;
+            }
+            reference.chain(x, y, stones, liberties);
+            group.clear();
+            if (board.get_group(x, y, group) != (int)stones.size() || !same_points(group, stones)) {
+                return "get_group" + at;
+            }
+            int count = board.get_liberties(x, y, 8, found);
+            if (count != std::min((int)liberties.size(), 8) ||
+                (liberties.size() <= 8 && !same_points(std::vector<Position>(found, found + count), liberties))) {
+                return "get_liberties" + at;
+            }
+            rebuilt.set(x, y, color);
+        }
+    }
+    // Captures leave no chain without a liberty behind
+    if (stones_without_liberties(bits[0], empty).any() || stones_without_liberties(bits[1], empty).any()) {
+        return "stones_without_liberties()";
+    }
+    if (!(board.get_ko() == reference.ko)) {
+        return "ko point";
+    }
+    for (int s = 0; s < SYMMETRIES; s++) {
+        if (board.get_symmetry_hash(s) != rebuilt.get_symmetry_hash(s)) {
+            return "hash under symmetry " + std::to_string(s);
+        }
+    }
+    return "";
+}
+
+struct Step {
+    Position move;
+    int color;
+    std::vector<Position> captured;
+    std::optional<Position> previous_ko;
+    std::optional<Position> previous_last_move;
+};
+
+// Plays seeded random games with random undos on Board and the reference
+// side by side, comparing after every step, then undoes back to the empty
+// board. Returns the number of positions compared, or -1 after printing
+// the first difference.
+template <int SIZE>
+long long run_games(int games, int moves_per_game, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    long long positions = 0;
+    for (int game = 0; game < games; game++) {
+        Board<SIZE> board;
+        ReferenceBoard<SIZE> reference;
+        std::vector<ReferenceBoard<SIZE>> snapshots;
+        std::vector<Step> steps;
+        int color = BLACK;
+        for (int move = 0; move < moves_per_game; move++) {
+            if (!steps.empty() && rng() % 8 == 0) {
+                const Step& step = steps.back();
+                board.undo_move(step.move.x, step.move.y, step.captured, step.previous_ko, step.previous_last_move);
+                reference = snapshots.back();
+                color = step.color;
+                steps.pop_back();
+                snapshots.pop_back();
+            } else {
+                std::vector<Position> legal = board.get_valid_moves(color);
+                if (legal.empty()) {
+                    break;
+                }
+                Step step{legal[rng() % legal.size()], color, {}, board.get_ko(), board.get_last_move()};
+                snapshots.push_back(reference);
+                std::vector<Position> reference_captured;
+                if (!board.make_move(step.move.x, step.move.y, color, &step.captured) ||
+                    !reference.play(step.move.x, step.move.y, color, reference_captured) ||
+                    !same_points(step.captured, reference_captured)) {
+                    std::cerr << SIZE << "x" << SIZE << " game " << game << ", move " << move
+                              << ": make_move differs" << std::endl;
+                    return -1;
+                }
+                steps.push_back(step);
+                color = get_opponent(color);
+            }
+            std::string difference = compare(board, reference);
+            positions++;
+            if (!difference.empty()) {
+                std::cerr << SIZE << "x" << SIZE << " game " << game << ", move " << move << ": " << difference
+                          << " differs" << std::endl;
+                return -1;
+            }
+        }
+        while (!steps.empty()) {
+            const Step& step = steps.back();
+            board.undo_move(step.move.x, step.move.y, step.captured, step.previous_ko, step.previous_last_move);
+            steps.pop_back();
+        }
+        if (board.get_hash() != 0 || board.get_canonical_hash() != 0) {
+            std::cerr << SIZE << "x" << SIZE << " game " << game << ": hash not 0 after undoing every move"
+                      << std::endl;
+            return -1;
+        }
+    }
+    return positions;
+}
+
+} // namespace
+
+// Differential test of the configured board backend: random games with
+// undos, every position checked against a flood-fill reference. Exits
+// nonzero on the first difference. CTest runs it; configure once with each
+// GO_BOARD_BACKEND to cover both.
+//
+// Usage: GoBackendTest [games_per_size] [seed]
+int main(int argc, char** argv) {
+    int games = argc > 1 ? std::atoi(argv[1]) : 8;
+    uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    long long positions = 0;
+    for (long long checked : {run_games<9>(games, 150, seed), run_games<13>(games, 250, seed + 1),
+                              run_games<19>(games, 400, seed + 2)}) {
+        if (checked < 0) {
+            return 1;
+        }
+        positions += checked;
+    }
+    std::cout << BACKEND << " backend: " << positions << " positions match the reference" << std::endl;
+    return 0;
+}
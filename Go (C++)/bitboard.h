@@ -0,0 +1,229 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#include <bitset>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit; bits must be non-zero
+inline int lowest_bit(uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// A set of points on a SIZE x SIZE board, one bit per point in row-major
+// order (bit y * SIZE + x). Whole-board questions such as "which groups have
+// no liberties" become a handful of word-wide shifts and masks instead of a
+// point-by-point traversal.
+template <int SIZE>
+struct Bitboard {
+    static constexpr int BITS = SIZE * SIZE;
+    static constexpr int WORDS = (BITS + 63) / 64;
+    
+    uint64_t words[WORDS];
+    
+    constexpr Bitboard() : words() {}
+    
+    static Bitboard point(int x, int y) {
+        Bitboard b;
+        b.set(x, y);
+        return b;
+    }
+    
+    bool test(int x, int y) const {
+        int i = y * SIZE + x;
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+    
+    void set(int x, int y) {
+        int i = y * SIZE + x;
+        words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    
+    void reset(int x, int y) {
+        int i = y * SIZE + x;
+        words[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+    
+    bool any() const {
+        uint64_t bits = 0;
+        for (int i = 0; i < WORDS; i++) {
+            bits |= words[i];
+        }
+        return bits != 0;
+    }
+    
+    int count() const {
+        int total = 0;
+        for (int i = 0; i < WORDS; i++) {
+            total += (int)std::bitset<64>(words[i]).count();
+        }
+        return total;
+    }
+    
+    // Calls f(x, y) for every point in the set, in index order
+    template <typename F>
+    void for_each(F f) const {
+        for (int i = 0; i < WORDS; i++) {
+            uint64_t bits = words[i];
+            while (bits) {
+                int index = i * 64 + lowest_bit(bits);
+                f(index % SIZE, index / SIZE);
+                bits &= bits - 1;
+            }
+        }
+    }
+    
+    constexpr bool operator==(const Bitboard& other) const {
+        for (int i = 0; i < WORDS; i++) {
+            if (words[i] != other.words[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    bool operator!=(const Bitboard& other) const {
+        return !(*this == other);
+    }
+    
+    constexpr Bitboard operator&(const Bitboard& other) const {
+        Bitboard result;
+        for (int i = 0; i < WORDS; i++) {
+            result.words[i] = words[i] & other.words[i];
+        }
+        return result;
+    }
+    
+    constexpr Bitboard operator|(const Bitboard& other) const {
+        Bitboard result;
+        for (int i = 0; i < WORDS; i++) {
+            result.words[i] = words[i] | other.words[i];
+        }
+        return result;
+    }
+    
+    // Points in this set but not in other
+    constexpr Bitboard operator-(const Bitboard& other) const {
+        Bitboard result;
+        for (int i = 0; i < WORDS; i++) {
+            result.words[i] = words[i] & ~other.words[i];
+        }
+        return result;
+    }
+};
+
+namespace bitboard_detail {
+
+template <int SIZE>
+constexpr Bitboard<SIZE> make_all_points() {
+    Bitboard<SIZE> b;
+    for (int i = 0; i < SIZE * SIZE; i++) {
+        b.words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    return b;
+}
+
+template <int SIZE>
+constexpr Bitboard<SIZE> make_column(int column) {
+    Bitboard<SIZE> b;
+    for (int y = 0; y < SIZE; y++) {
+        int i = y * SIZE + column;
+        b.words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    return b;
+}
+
+template <int SIZE>
+inline constexpr Bitboard<SIZE> ALL_POINTS = make_all_points<SIZE>();
+template <int SIZE>
+inline constexpr Bitboard<SIZE> NOT_FIRST_COLUMN = ALL_POINTS<SIZE> - make_column<SIZE>(0);
+template <int SIZE>
+inline constexpr Bitboard<SIZE> NOT_LAST_COLUMN = ALL_POINTS<SIZE> - make_column<SIZE>(SIZE - 1);
+
+// Moves every bit `shift` places towards higher indices (0 < shift < 64)
+template <int SIZE>
+Bitboard<SIZE> shift_up(const Bitboard<SIZE>& b, int shift) {
+    Bitboard<SIZE> result;
+    result.words[0] = b.words[0] << shift;
+    for (int i = 1; i < Bitboard<SIZE>::WORDS; i++) {
+        result.words[i] = (b.words[i] << shift) | (b.words[i - 1] >> (64 - shift));
+    }
+    return result;
+}
+
+// Moves every bit `shift` places towards lower indices (0 < shift < 64)
+template <int SIZE>
+Bitboard<SIZE> shift_down(const Bitboard<SIZE>& b, int shift) {
+    constexpr int last = Bitboard<SIZE>::WORDS - 1;
+    Bitboard<SIZE> result;
+    for (int i = 0; i < last; i++) {
+        result.words[i] = (b.words[i] >> shift) | (b.words[i + 1] << (64 - shift));
+    }
+    result.words[last] = b.words[last] >> shift;
+    return result;
+}
+
+} // namespace bitboard_detail
+
+// Every on-board point
+template <int SIZE>
+Bitboard<SIZE> all_points() {
+    return bitboard_detail::ALL_POINTS<SIZE>;
+}
+
+// Points orthogonally adjacent to the set (the set itself not included
+// unless two of its points touch)
+template <int SIZE>
+Bitboard<SIZE> neighbors(const Bitboard<SIZE>& b) {
+    using namespace bitboard_detail;
+    Bitboard<SIZE> east = shift_up(b, 1) & NOT_FIRST_COLUMN<SIZE>;
+    Bitboard<SIZE> west = shift_down(b, 1) & NOT_LAST_COLUMN<SIZE>;
+    Bitboard<SIZE> south = shift_up(b, SIZE);
+    Bitboard<SIZE> north = shift_down(b, SIZE);
+    return (east | west | south | north) & ALL_POINTS<SIZE>;
+}
+
+// Grows seed through mask by repeated dilation until it stops changing:
+// every point of mask connected to seed
+template <int SIZE>
+Bitboard<SIZE> flood_fill(Bitboard<SIZE> seed, const Bitboard<SIZE>& mask) {
+    seed = seed & mask;
+    while (true) {
+        Bitboard<SIZE> grown = (seed | neighbors(seed)) & mask;
+        if (grown == seed) {
+            return seed;
+        }
+        seed = grown;
+    }
+}
+
+// Stones belonging to groups without a single liberty in empty
+template <int SIZE>
+Bitboard<SIZE> stones_without_liberties(const Bitboard<SIZE>& stones, const Bitboard<SIZE>& empty) {
+    Bitboard<SIZE> alive = flood_fill(stones & neighbors(empty), stones);
+    return stones - alive;
+}
+
+// Splits the empty points into those whose region borders only black,
+// only white, or both/neither (the latter are left out of both results)
+template <int SIZE>
+void territory(const Bitboard<SIZE>& black, const Bitboard<SIZE>& white,
+               Bitboard<SIZE>& black_area, Bitboard<SIZE>& white_area) {
+    Bitboard<SIZE> empty = all_points<SIZE>() - (black | white);
+    Bitboard<SIZE> reaches_black = flood_fill(empty & neighbors(black), empty);
+    Bitboard<SIZE> reaches_white = flood_fill(empty & neighbors(white), empty);
+    black_area = reaches_black - reaches_white;
+    white_area = reaches_white - reaches_black;
+}
+
+#endif // BITBOARD_H
+
@@ -1,258 +1,608 @@
 #include "board.h"
-#include <unordered_set>
 #include <algorithm>
 
-Board::Board() {
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            grid[y][x] = EMPTY;
+namespace {
+
+// Zobrist keys, one per (color, point), generated at compile time with
+// splitmix64 so hashes are identical across runs and platforms. Smaller
+// boards use the keys of the first points of their padded array.
+constexpr int MAX_POINTS = Board<19>::POINTS;
+
+struct ZobristKeys {
+    uint64_t keys[2][MAX_POINTS];
+    
+    constexpr ZobristKeys() : keys() {
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for (int c = 0; c < 2; c++) {
+            for (int p = 0; p < MAX_POINTS; p++) {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                keys[c][p] = z ^ (z >> 31);
+            }
         }
     }
-    ko = std::nullopt;
-    last_move = std::nullopt;
+};
+
+constexpr ZobristKeys ZOBRIST;
+
+uint64_t zobrist_key(int color, int p) {
+    return ZOBRIST.keys[color - 1][p];
 }
 
-Board::Board(const Board& other) {
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            grid[y][x] = other.grid[y][x];
+// Padded index of every point under symmetries 1-7, so a stone updates the
+// symmetry hashes with the keys of the points it maps to
+template <int SIZE>
+struct SymmetryPoints {
+    uint16_t points[Board<SIZE>::POINTS][SYMMETRIES - 1];
+    
+    constexpr SymmetryPoints() : points() {
+        constexpr int STRIDE = Board<SIZE>::STRIDE;
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                for (int s = 1; s < SYMMETRIES; s++) {
+                    Position to = apply_symmetry(Position(x, y), s, SIZE);
+                    points[(y + 1) * STRIDE + (x + 1)][s - 1] = (to.y + 1) * STRIDE + (to.x + 1);
+                }
+            }
         }
     }
-    ko = other.ko;
-    last_move = other.last_move;
+};
+
+template <int SIZE>
+constexpr SymmetryPoints<SIZE> SYMMETRY_POINTS;
+
+template <int SIZE>
+void update_symmetry_hashes(uint64_t* hashes, int color, int p) {
+    const uint16_t* points = SYMMETRY_POINTS<SIZE>.points[p];
+    for (int s = 0; s < SYMMETRIES - 1; s++) {
+        hashes[s] ^= zobrist_key(color, points[s]);
+    }
 }
 
-Board& Board::operator=(const Board& other) {
-    if (this != &other) {
-        for (int y = 0; y < BOARD_SIZE; y++) {
-            for (int x = 0; x < BOARD_SIZE; x++) {
-                grid[y][x] = other.grid[y][x];
+} // namespace
+
+template <int SIZE>
+Board<SIZE>::Board() {
+    for (int p = 0; p < POINTS; p++) {
+        cells[p] = OFFBOARD;
+        chain_head[p] = p;
+        chain_next[p] = p;
+        chains[p] = Chain{0, 0, 0, 0, 0};
+        dirty[p] = false;
+    }
+    for (int i = 0; i < LEGAL_WORDS; i++) {
+        legal_bits[0][i] = 0;
+        legal_bits[1][i] = 0;
+    }
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            int p = point_index(x, y);
+            cells[p] = EMPTY;
+            legal_bits[0][p / 64] |= uint64_t(1) << (p % 64);
+            legal_bits[1][p / 64] |= uint64_t(1) << (p % 64);
+        }
+    }
+    dirty_count = 0;
+    for (int p = 0; p < POINTS; p++) {
+        patterns[p] = 0;
+        if (cells[p] == EMPTY) {
+            for (int i = 0; i < 4; i++) {
+                patterns[p] |= (uint32_t)cells[p + NEIGHBOR_OFFSETS[i]] << (2 * i);
+                patterns[p] |= (uint32_t)cells[p + DIAGONAL_OFFSETS[i]] << (8 + 2 * i);
             }
         }
-        ko = other.ko;
-        last_move = other.last_move;
     }
-    return *this;
+    ko = std::nullopt;
+    last_move = std::nullopt;
+    hash = 0;
+    std::fill(symmetry_hashes, symmetry_hashes + SYMMETRIES - 1, 0);
 }
 
-int Board::get(int x, int y) const {
-    if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE) {
+template <int SIZE>
+int Board<SIZE>::get(int x, int y) const {
+    // One unsigned compare per coordinate also rejects negative values
+    if ((unsigned)x >= (unsigned)SIZE || (unsigned)y >= (unsigned)SIZE) {
         return -1;
     }
-    return grid[y][x];
+    return cells[point_index(x, y)];
 }
 
-void Board::set(int x, int y, int color) {
-    if (x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE) {
-        grid[y][x] = color;
+template <int SIZE>
+void Board<SIZE>::set(int x, int y, int color) {
+    if ((unsigned)x < (unsigned)SIZE && (unsigned)y < (unsigned)SIZE) {
+        int p = point_index(x, y);
+        if (cells[p] != EMPTY) {
+            events.report(BoardEvent::StoneRemoved, cells[p], x, y);
+            remove_stone(p);
+        }
+        if (color != EMPTY) {
+            place_stone(p, color);
+            events.report(BoardEvent::StonePlaced, color, x, y);
+        }
+        refresh_legal_moves();
+    }
+}
+
+template <int SIZE>
+int Board<SIZE>::remove_group(int x, int y) {
+    if ((unsigned)x >= (unsigned)SIZE || (unsigned)y >= (unsigned)SIZE || get(x, y) == EMPTY) {
+        return 0;
+    }
+    int head = chain_head[point_index(x, y)];
+    int count = chains[head].size;
+    if (events) {
+        int s = head;
+        do {
+            Position pos = point_position(s);
+            events.report(BoardEvent::StoneRemoved, cells[s], pos.x, pos.y);
+            s = chain_next[s];
+        } while (s != head);
     }
+    remove_chain(head);
+    refresh_legal_moves();
+    return count;
+}
+
+template <int SIZE>
+void Board<SIZE>::clear() {
+    *this = Board();
+    events.report(BoardEvent::Cleared, EMPTY, -1, -1);
+}
+
+template <int SIZE>
+void Board<SIZE>::set_event_log(BoardEventLog* log) {
+    events.attach(log);
+}
+
+template <int SIZE>
+void Board<SIZE>::add_liberty(int head, int p) {
+    mark_atari_liberty(head);
+    Chain& chain = chains[head];
+    chain.liberties++;
+    chain.liberty_sum += p;
+    chain.liberty_sum_sq += p * p;
+    mark_atari_liberty(head);
 }
 
-std::vector<Position> Board::get_neighbors(int x, int y) const {
-    std::vector<Position> neighbors;
-    if (x > 0) neighbors.push_back(Position(x - 1, y));
-    if (x < BOARD_SIZE - 1) neighbors.push_back(Position(x + 1, y));
-    if (y > 0) neighbors.push_back(Position(x, y - 1));
-    if (y < BOARD_SIZE - 1) neighbors.push_back(Position(x, y + 1));
-    return neighbors;
+template <int SIZE>
+void Board<SIZE>::remove_liberty(int head, int p) {
+    mark_atari_liberty(head);
+    Chain& chain = chains[head];
+    chain.liberties--;
+    chain.liberty_sum -= p;
+    chain.liberty_sum_sq -= p * p;
+    mark_atari_liberty(head);
 }
 
-std::vector<Position> Board::get_group(int x, int y) const {
-    int color = get(x, y);
-    if (color == EMPTY || color == -1) {
-        return {};
+template <int SIZE>
+bool Board<SIZE>::chain_in_atari(int head) const {
+    // All pseudo-liberties are the same point exactly when
+    // n * sum(p^2) == sum(p)^2 (the equality case of Cauchy-Schwarz)
+    const Chain& chain = chains[head];
+    return chain.liberties > 0 &&
+           (int64_t)chain.liberties * chain.liberty_sum_sq == (int64_t)chain.liberty_sum * chain.liberty_sum;
+}
+
+template <int SIZE>
+void Board<SIZE>::merge_chains(int a, int b) {
+    // Relabel the smaller chain so a merge costs O(min size)
+    if (chains[a].size < chains[b].size) {
+        std::swap(a, b);
     }
+    int p = b;
+    do {
+        chain_head[p] = a;
+        p = chain_next[p];
+    } while (p != b);
     
-    std::vector<Position> group;
-    std::unordered_set<Position, PositionHash> visited;
-    std::vector<Position> stack;
-    stack.push_back(Position(x, y));
+    // Splice the two circular stone lists together
+    std::swap(chain_next[a], chain_next[b]);
     
-    while (!stack.empty()) {
-        Position pos = stack.back();
-        stack.pop_back();
-        
-        if (visited.find(pos) != visited.end()) {
-            continue;
+    chains[a].size += chains[b].size;
+    chains[a].liberties += chains[b].liberties;
+    chains[a].liberty_sum += chains[b].liberty_sum;
+    chains[a].liberty_sum_sq += chains[b].liberty_sum_sq;
+    chains[a].hash ^= chains[b].hash;
+}
+
+template <int SIZE>
+void Board<SIZE>::place_stone(int p, int color) {
+    cells[p] = color;
+    chain_head[p] = p;
+    chain_next[p] = p;
+    chains[p] = Chain{1, 0, 0, 0, zobrist_key(color, p)};
+    mark_dirty(p);
+    set_pattern_cell(p, color);
+    hash ^= chains[p].hash;
+    update_symmetry_hashes<SIZE>(symmetry_hashes, color, p);
+#ifdef GO_BITBOARD_BACKEND
+    Position pos = point_position(p);
+    stone_bits[color - 1].set(pos.x, pos.y);
+#endif
+
+    for (int offset : NEIGHBOR_OFFSETS) {
+        int n = p + offset;
+        if (cells[n] == EMPTY) {
+            add_liberty(p, n);
+            mark_dirty(n);
+        } else if (cells[n] != OFFBOARD) {
+            remove_liberty(chain_head[n], p);
         }
-        visited.insert(pos);
-        group.push_back(pos);
-        
-        auto neighbors = get_neighbors(pos.x, pos.y);
-        for (const auto& n : neighbors) {
-            if (visited.find(n) == visited.end() && get(n.x, n.y) == color) {
-                stack.push_back(n);
-            }
+    }
+    for (int offset : NEIGHBOR_OFFSETS) {
+        int n = p + offset;
+        if (cells[n] == color && chain_head[n] != chain_head[p]) {
+            merge_chains(chain_head[n], chain_head[p]);
         }
     }
-    
-    return group;
+    mark_atari_liberty(chain_head[p]);
 }
 
-bool Board::has_liberties(int x, int y) const {
-    int color = get(x, y);
-    if (color == EMPTY || color == -1) {
-        return false;
-    }
+template <int SIZE>
+void Board<SIZE>::remove_chain(int head) {
+    hash ^= chains[head].hash;
+    int p = head;
+    do {
+#ifdef GO_BITBOARD_BACKEND
+        Position pos = point_position(p);
+        stone_bits[cells[p] - 1].reset(pos.x, pos.y);
+#endif
+        update_symmetry_hashes<SIZE>(symmetry_hashes, cells[p], p);
+        cells[p] = EMPTY;
+        mark_dirty(p);
+        set_pattern_cell(p, EMPTY);
+        p = chain_next[p];
+    } while (p != head);
     
-    std::unordered_set<Position, PositionHash> visited;
-    std::vector<Position> stack;
-    stack.push_back(Position(x, y));
-    
-    while (!stack.empty()) {
-        Position pos = stack.back();
-        stack.pop_back();
-        
-        if (visited.find(pos) != visited.end()) {
-            continue;
-        }
-        visited.insert(pos);
-        
-        auto neighbors = get_neighbors(pos.x, pos.y);
-        for (const auto& n : neighbors) {
-            int neighbor_color = get(n.x, n.y);
-            if (neighbor_color == EMPTY) {
-                return true;
-            }
-            if (neighbor_color == color && visited.find(n) == visited.end()) {
-                stack.push_back(n);
+    // Hand the freed points back to the surrounding chains as liberties
+    do {
+        for (int offset : NEIGHBOR_OFFSETS) {
+            int n = p + offset;
+            if (cells[n] == BLACK || cells[n] == WHITE) {
+                add_liberty(chain_head[n], p);
+            } else if (cells[n] == EMPTY) {
+                mark_dirty(n);
             }
         }
+        p = chain_next[p];
+    } while (p != head);
+}
+
+template <int SIZE>
+void Board<SIZE>::remove_stone(int p) {
+    // Removing a single stone may split its chain, so lift the whole chain
+    // and put the remaining stones back one by one.
+    int color = cells[p];
+    int stones[SIZE * SIZE];
+    int count = get_group(p, stones);
+    
+    remove_chain(chain_head[p]);
+    for (int i = 0; i < count; i++) {
+        if (stones[i] != p) {
+            place_stone(stones[i], color);
+        }
+    }
+}
+
+template <int SIZE>
+int Board<SIZE>::get_group(int p, int* stones) const {
+    if (cells[p] != BLACK && cells[p] != WHITE) {
+        return 0;
     }
     
-    return false;
+    int count = 0;
+    int head = chain_head[p];
+    int s = head;
+    do {
+        stones[count++] = s;
+        s = chain_next[s];
+    } while (s != head);
+    
+    return count;
 }
 
-bool Board::group_has_liberties(const std::vector<Position>& group) const {
-    for (const auto& pos : group) {
-        if (has_liberties(pos.x, pos.y)) {
-            return true;
-        }
+template <int SIZE>
+int Board<SIZE>::get_group(int x, int y, std::vector<Position>& stones) const {
+    if ((unsigned)x >= (unsigned)SIZE || (unsigned)y >= (unsigned)SIZE) {
+        return 0;
     }
-    return false;
+    int points[SIZE * SIZE];
+    int count = get_group(point_index(x, y), points);
+    for (int i = 0; i < count; i++) {
+        stones.push_back(point_position(points[i]));
+    }
+    return count;
 }
 
-std::vector<std::vector<Position>> Board::capture_groups(int x, int y, int color) {
-    std::vector<std::vector<Position>> captured;
-    std::unordered_set<Position, PositionHash> visited;
+template <int SIZE>
+int Board<SIZE>::get_liberties(int x, int y, int limit, Position* liberties) const {
+    if ((unsigned)x >= (unsigned)SIZE || (unsigned)y >= (unsigned)SIZE || limit <= 0) {
+        return 0;
+    }
+    int p = point_index(x, y);
+    if (cells[p] != BLACK && cells[p] != WHITE) {
+        return 0;
+    }
+    int head = chain_head[p];
+    if (chain_in_atari(head)) {
+        liberties[0] = point_position(chains[head].liberty_sum / chains[head].liberties);
+        return 1;
+    }
     
-    auto neighbors = get_neighbors(x, y);
-    for (const auto& pos : neighbors) {
-        if (visited.find(pos) != visited.end()) {
-            continue;
-        }
-        if (get(pos.x, pos.y) == color) {
-            auto group = get_group(pos.x, pos.y);
-            if (!group_has_liberties(group)) {
-                captured.push_back(group);
-                for (const auto& p : group) {
-                    visited.insert(p);
-                    set(p.x, p.y, EMPTY);
+    // Few liberties are asked for, so a linear check for repeats is enough
+    int found[8];
+    int count = 0;
+    limit = std::min(limit, 8);
+    int s = head;
+    do {
+        for (int offset : NEIGHBOR_OFFSETS) {
+            int n = s + offset;
+            if (cells[n] == EMPTY && std::find(found, found + count, n) == found + count) {
+                liberties[count] = point_position(n);
+                found[count++] = n;
+                if (count == limit) {
+                    return count;
                 }
             }
         }
+        s = chain_next[s];
+    } while (s != head);
+    return count;
+}
+
+template <int SIZE>
+bool Board<SIZE>::has_liberties(int p) const {
+    if (cells[p] != BLACK && cells[p] != WHITE) {
+        return false;
+    }
+    return chains[chain_head[p]].liberties > 0;
+}
+
+template <int SIZE>
+int Board<SIZE>::capture_groups(int p, int color, int* captured_point, std::vector<Position>* removed) {
+    // Returns the number of stones captured; captured_point receives one of them
+    int captured = 0;
+    
+    for (int offset : NEIGHBOR_OFFSETS) {
+        int n = p + offset;
+        // A chain touching the point twice is already gone on the second visit
+        if (cells[n] == color && !has_liberties(n)) {
+            int head = chain_head[n];
+            captured += chains[head].size;
+            *captured_point = n;
+            if (removed || events) {
+                int s = head;
+                do {
+                    Position pos = point_position(s);
+                    if (removed) {
+                        removed->push_back(pos);
+                    }
+                    events.report(BoardEvent::StoneRemoved, color, pos.x, pos.y);
+                    s = chain_next[s];
+                } while (s != head);
+            }
+            remove_chain(head);
+        }
     }
     
     return captured;
 }
 
-bool Board::is_valid_move(int x, int y, int color) const {
-    if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE) {
-        return false;
-    }
-    if (grid[y][x] != EMPTY) {
+template <int SIZE>
+bool Board<SIZE>::is_legal(int p, int color) const {
+    if (cells[p] != EMPTY) {
         return false;
     }
     
     // Check ko rule
-    if (ko.has_value() && ko->x == x && ko->y == y) {
+    if (ko.has_value() && point_index(ko->x, ko->y) == p) {
         return false;
     }
     
-    // Try the move
-    Board test_board = *this;
-    test_board.set(x, y, color);
-    
-    // Capture opponent groups first
-    auto captured = test_board.capture_groups(x, y, get_opponent(color));
-    
-    // If no opponent groups were captured, check if the move is suicide
-    if (captured.empty()) {
-        // Check if the newly placed stone's group has liberties
-        if (!test_board.has_liberties(x, y)) {
-            return false; // Suicide move - invalid
+    // Decide from the neighbors alone, without playing the move. Any chain
+    // in atari next to p has p as its last liberty.
+    for (int offset : NEIGHBOR_OFFSETS) {
+        int n = p + offset;
+        int cell = cells[n];
+        if (cell == EMPTY) {
+            return true;
+        }
+        if (cell == color) {
+            if (!chain_in_atari(chain_head[n])) {
+                return true; // Joins a chain that keeps another liberty
+            }
+        } else if (cell != OFFBOARD) {
+            if (chain_in_atari(chain_head[n])) {
+                return true; // Captures
+            }
         }
     }
     
-    return true;
+    return false; // Suicide move - invalid
+}
+
+template <int SIZE>
+void Board<SIZE>::mark_dirty(int p) {
+    if (!dirty[p] && cells[p] != OFFBOARD) {
+        dirty[p] = true;
+        dirty_points[dirty_count++] = p;
+    }
+}
+
+template <int SIZE>
+void Board<SIZE>::set_pattern_cell(int p, int color) {
+    // p is neighbor i of p - NEIGHBOR_OFFSETS[i] and neighbor 4 + i of
+    // p - DIAGONAL_OFFSETS[i]
+    for (int i = 0; i < 4; i++) {
+        uint32_t& side = patterns[p - NEIGHBOR_OFFSETS[i]];
+        side = (side & ~(3u << (2 * i))) | (uint32_t)color << (2 * i);
+        uint32_t& corner = patterns[p - DIAGONAL_OFFSETS[i]];
+        corner = (corner & ~(3u << (8 + 2 * i))) | (uint32_t)color << (8 + 2 * i);
+    }
+}
+
+template <int SIZE>
+uint32_t Board<SIZE>::pattern_atari_bits(int p) const {
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; i++) {
+        int n = p + NEIGHBOR_OFFSETS[i];
+        if ((cells[n] == BLACK || cells[n] == WHITE) && chain_in_atari(chain_head[n])) {
+            bits |= 1u << (PATTERN_ATARI_SHIFT + i);
+        }
+    }
+    return bits;
+}
+
+template <int SIZE>
+void Board<SIZE>::mark_atari_liberty(int head) {
+    if (chain_in_atari(head)) {
+        mark_dirty(chains[head].liberty_sum / chains[head].liberties);
+    }
+}
+
+template <int SIZE>
+void Board<SIZE>::refresh_legal_moves() {
+    for (int i = 0; i < dirty_count; i++) {
+        int p = dirty_points[i];
+        dirty[p] = false;
+        for (int c = 0; c < 2; c++) {
+            uint64_t bit = uint64_t(1) << (p % 64);
+            if (is_legal(p, c + 1)) {
+                legal_bits[c][p / 64] |= bit;
+            } else {
+                legal_bits[c][p / 64] &= ~bit;
+            }
+        }
+        if (cells[p] == EMPTY) {
+            patterns[p] = (patterns[p] & ((1u << PATTERN_ATARI_SHIFT) - 1)) | pattern_atari_bits(p);
+        }
+    }
+    dirty_count = 0;
+}
+
+template <int SIZE>
+bool Board<SIZE>::is_valid_move(int x, int y, int color) const {
+    if ((unsigned)x >= (unsigned)SIZE || (unsigned)y >= (unsigned)SIZE) {
+        return false;
+    }
+    int p = point_index(x, y);
+    return (legal_bits[color - 1][p / 64] >> (p % 64)) & 1;
 }
 
-bool Board::make_move(int x, int y, int color) {
+template <int SIZE>
+bool Board<SIZE>::make_move(int x, int y, int color, std::vector<Position>* captured_stones) {
     if (!is_valid_move(x, y, color)) {
         return false;
     }
     
-    set(x, y, color);
+    int p = point_index(x, y);
+    place_stone(p, color);
+    events.report(BoardEvent::StonePlaced, color, x, y);
     last_move = Position(x, y);
     
     // Capture opponent stones
-    auto captured = capture_groups(x, y, get_opponent(color));
-    if (captured.size() == 1 && captured[0].size() == 1) {
-        ko = captured[0][0];
+    int captured_point;
+    int captured = capture_groups(p, get_opponent(color), &captured_point, captured_stones);
+    if (captured == 1) {
+        set_ko(point_position(captured_point));
     } else {
-        ko = std::nullopt;
+        set_ko(std::nullopt);
     }
+    refresh_legal_moves();
     
     return true;
 }
 
-std::vector<Position> Board::get_valid_moves(int color) const {
+template <int SIZE>
+void Board<SIZE>::undo_move(int x, int y, const std::vector<Position>& captured,
+                            std::optional<Position> previous_ko, std::optional<Position> previous_last_move) {
+    int p = point_index(x, y);
+    int opponent = get_opponent(cells[p]);
+    events.report(BoardEvent::StoneRemoved, cells[p], x, y);
+    remove_stone(p);
+    for (const auto& pos : captured) {
+        place_stone(point_index(pos.x, pos.y), opponent);
+        events.report(BoardEvent::StonePlaced, opponent, pos.x, pos.y);
+    }
+    set_ko(previous_ko);
+    last_move = previous_last_move;
+    refresh_legal_moves();
+}
+
+template <int SIZE>
+void Board<SIZE>::set_ko(std::optional<Position> point) {
+    // Both the old and the new ko point change legality
+    if (ko.has_value()) {
+        mark_dirty(point_index(ko->x, ko->y));
+    }
+    if (events && !(ko == point)) {
+        if (point.has_value()) {
+            events.report(BoardEvent::KoSet, EMPTY, point->x, point->y);
+        } else {
+            events.report(BoardEvent::KoCleared, EMPTY, -1, -1);
+        }
+    }
+    ko = point;
+    if (ko.has_value()) {
+        mark_dirty(point_index(ko->x, ko->y));
+    }
+}
+
+template <int SIZE>
+std::optional<Position> Board<SIZE>::get_ko() const {
+    return ko;
+}
+
+template <int SIZE>
+std::optional<Position> Board<SIZE>::get_last_move() const {
+    return last_move;
+}
+
+template <int SIZE>
+std::vector<Position> Board<SIZE>::get_valid_moves(int color) const {
+    // Walking the bitset in index order yields the moves row by row
     std::vector<Position> moves;
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            if (is_valid_move(x, y, color)) {
-                moves.push_back(Position(x, y));
-            }
+    for (int i = 0; i < LEGAL_WORDS; i++) {
+        uint64_t bits = legal_bits[color - 1][i];
+        while (bits) {
+            moves.push_back(point_position(i * 64 + lowest_bit(bits)));
+            bits &= bits - 1;
         }
     }
     return moves;
 }
 
-int Board::get_territory_owner(int x, int y) const {
+template <int SIZE>
+int Board<SIZE>::get_territory_owner(int x, int y) const {
     // Returns BLACK, WHITE, or EMPTY if neutral
     if (get(x, y) != EMPTY) {
         return EMPTY;
     }
     
-    std::unordered_set<Position, PositionHash> visited;
-    std::vector<Position> stack;
-    stack.push_back(Position(x, y));
+    bool visited[POINTS] = {};
+    int stack[SIZE * SIZE];
+    int top = 0;
+    int start = point_index(x, y);
+    stack[top++] = start;
+    visited[start] = true;
     bool has_black = false;
     bool has_white = false;
     
-    while (!stack.empty()) {
-        Position pos = stack.back();
-        stack.pop_back();
-        
-        if (visited.find(pos) != visited.end()) {
-            continue;
-        }
-        visited.insert(pos);
+    while (top > 0) {
+        int p = stack[--top];
         
-        auto neighbors = get_neighbors(pos.x, pos.y);
-        for (const auto& n : neighbors) {
-            if (n.x < 0 || n.x >= BOARD_SIZE || n.y < 0 || n.y >= BOARD_SIZE) {
-                continue;
-            }
-            int cell = get(n.x, n.y);
+        for (int offset : NEIGHBOR_OFFSETS) {
+            int n = p + offset;
+            int cell = cells[n];
             if (cell == BLACK) {
                 has_black = true;
             } else if (cell == WHITE) {
                 has_white = true;
-            } else if (cell == EMPTY) {
-                if (visited.find(n) == visited.end()) {
-                    stack.push_back(n);
-                }
+            } else if (cell == EMPTY && !visited[n]) {
+                visited[n] = true;
+                stack[top++] = n;
             }
         }
     }
@@ -267,6 +617,101 @@ int Board::get_territory_owner(int x, int y) const {
     }
 }
 
+template <int SIZE>
+bool Board<SIZE>::is_eye(int x, int y, int color) const {
+    if (get(x, y) != EMPTY) {
+        return false;
+    }
+    int p = point_index(x, y);
+    for (int offset : NEIGHBOR_OFFSETS) {
+        if (cells[p + offset] != color && cells[p + offset] != OFFBOARD) {
+            return false;
+        }
+    }
+    
+    // A false eye: too many diagonals held by the opponent (one is enough
+    // on the edge, two in the middle of the board)
+    int opponent = get_opponent(color);
+    int opponent_diagonals = 0;
+    bool on_edge = false;
+    for (int offset : DIAGONAL_OFFSETS) {
+        int cell = cells[p + offset];
+        if (cell == OFFBOARD) {
+            on_edge = true;
+        } else if (cell == opponent) {
+            opponent_diagonals++;
+        }
+    }
+    return opponent_diagonals < (on_edge ? 1 : 2);
+}
+
+template <int SIZE>
+uint64_t Board<SIZE>::get_hash() const {
+    return hash;
+}
+
+template <int SIZE>
+uint64_t Board<SIZE>::hash_after_move(int x, int y, int color) const {
+    int p = point_index(x, y);
+    uint64_t result = hash ^ zobrist_key(color, p);
+    
+    // Adjacent opponent chains in atari lose their last liberty to p
+    int opponent = get_opponent(color);
+    int captured[4];
+    int count = 0;
+    for (int offset : NEIGHBOR_OFFSETS) {
+        int n = p + offset;
+        if (cells[n] != opponent || !chain_in_atari(chain_head[n])) {
+            continue;
+        }
+        int head = chain_head[n];
+        if (std::find(captured, captured + count, head) == captured + count) {
+            captured[count++] = head;
+            result ^= chains[head].hash;
+        }
+    }
+    
+    return result;
+}
+
+template <int SIZE>
+uint64_t Board<SIZE>::get_symmetry_hash(int symmetry) const {
+    return symmetry == 0 ? hash : symmetry_hashes[symmetry - 1];
+}
+
+template <int SIZE>
+uint64_t Board<SIZE>::get_canonical_hash() const {
+    return get_symmetry_hash(get_canonical_symmetry());
+}
+
+template <int SIZE>
+int Board<SIZE>::get_canonical_symmetry() const {
+    int best = 0;
+    for (int s = 1; s < SYMMETRIES; s++) {
+        if (symmetry_hashes[s - 1] < get_symmetry_hash(best)) {
+            best = s;
+        }
+    }
+    return best;
+}
+
+template <int SIZE>
+Bitboard<SIZE> Board<SIZE>::get_stones(int color) const {
+#ifdef GO_BITBOARD_BACKEND
+    return stone_bits[color - 1];
+#else
+    Bits stones;
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            if (cells[point_index(x, y)] == color) {
+                stones.set(x, y);
+            }
+        }
+    }
+    return stones;
+#endif
+}
+
 int get_opponent(int color) {
     if (color == BLACK) {
         return WHITE;
@@ -275,3 +720,15 @@ int get_opponent(int color) {
     }
 }
 
+bool is_supported_board_size(int size) {
+    for (int supported : BOARD_SIZES) {
+        if (size == supported) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template class Board<9>;
+template class Board<13>;
+template class Board<19>;
@@ -3,57 +3,295 @@
 
 #include <vector>
 #include <optional>
+#include <cstdint>
+#include <type_traits>
+#include "bitboard.h"
+
+// Board sizes the engine is built for. Board, Game and everything built on
+// them are templates over the size, so each one gets its own storage, loop
+// bounds and neighbor offsets as compile-time constants.
+constexpr int BOARD_SIZES[] = {9, 13, 19};
+constexpr int DEFAULT_BOARD_SIZE = 19;
 
-constexpr int BOARD_SIZE = 19;
 constexpr int EMPTY = 0;
 constexpr int BLACK = 1;
 constexpr int WHITE = 2;
+constexpr int OFFBOARD = 3;
+
+// A 3x3 pattern code, as Board::get_pattern returns it, has 2 bits per
+// neighbor holding its color (EMPTY, BLACK, WHITE or OFFBOARD) followed by
+// one bit per orthogonal neighbor whose chain is in atari. Neighbors are
+// ordered west, east, north, south, then northwest, northeast, southwest,
+// southeast.
+constexpr int PATTERN_BITS = 20;
+constexpr int PATTERN_ATARI_SHIFT = 16;
 
 struct Position {
     int x;
     int y;
     
-    Position(int x, int y) : x(x), y(y) {}
+    constexpr Position() : x(-1), y(-1) {}   // a pass
+    constexpr Position(int x, int y) : x(x), y(y) {}
     
     bool operator==(const Position& other) const {
         return x == other.x && y == other.y;
     }
 };
 
+// The eight symmetries of the square board, numbered 0-7: 0 is the
+// identity, 1-3 rotate by 90, 180 and 270 degrees, and 4-7 mirror
+// left-right, top-bottom and across the two diagonals.
+constexpr int SYMMETRIES = 8;
+
+// Where pos lands on a size x size board under symmetry; a pass stays a pass
+constexpr Position apply_symmetry(Position pos, int symmetry, int size) {
+    if (pos.x < 0) {
+        return pos;
+    }
+    int last = size - 1;
+    switch (symmetry) {
+        case 1: return Position(last - pos.y, pos.x);
+        case 2: return Position(last - pos.x, last - pos.y);
+        case 3: return Position(pos.y, last - pos.x);
+        case 4: return Position(last - pos.x, pos.y);
+        case 5: return Position(pos.x, last - pos.y);
+        case 6: return Position(pos.y, pos.x);
+        case 7: return Position(last - pos.y, last - pos.x);
+        default: return pos;
+    }
+}
+
+// The symmetry that undoes symmetry: the two quarter turns swap, every
+// other symmetry is its own inverse
+constexpr int inverse_symmetry(int symmetry) {
+    return symmetry == 1 ? 3 : symmetry == 3 ? 1 : symmetry;
+}
+
+// One change to a board. A move reports its stone, then the stones it
+// captured, then the ko point if it changed; an undo reports the same
+// changes the other way round.
+struct BoardEvent {
+    enum Kind : uint8_t {
+        StonePlaced,
+        StoneRemoved,
+        KoSet,          // (x, y) is the new ko point, replacing any old one
+        KoCleared,
+        Cleared         // every stone and the ko point are gone
+    };
+    
+    Kind kind;
+    uint8_t color;      // of the stone; EMPTY for the others
+    int8_t x;
+    int8_t y;
+};
+
+// Where a board reports its changes while attached with set_event_log.
+// The consumer applies events and clears them, so keeping up with the
+// board costs O(changes) instead of a scan of every point.
+struct BoardEventLog {
+    std::vector<BoardEvent> events;
+};
+
 struct PositionHash {
     std::size_t operator()(const Position& pos) const {
         return std::hash<int>()(pos.x) ^ (std::hash<int>()(pos.y) << 1);
     }
 };
 
+// A board's attached event log. Copies of a board start detached and an
+// assigned board keeps its own log, so the copies that playouts and
+// searches make never report into the original's log.
+class BoardEventHook {
+private:
+    BoardEventLog* log = nullptr;
+
+public:
+    BoardEventHook() = default;
+    BoardEventHook(const BoardEventHook&) {}
+    BoardEventHook& operator=(const BoardEventHook&) { return *this; }
+    
+    void attach(BoardEventLog* target) { log = target; }
+    
+    void report(BoardEvent::Kind kind, int color, int x, int y) {
+        if (log) {
+            log->events.push_back(BoardEvent{kind, (uint8_t)color, (int8_t)x, (int8_t)y});
+        }
+    }
+    
+    explicit operator bool() const { return log != nullptr; }
+};
+
+// Points are stored row-major in a 1D array with a one-point OFFBOARD ring
+// around the playing area, so neighbors are always at +-1 and +-STRIDE
+// and never need a bounds check.
+template <int SIZE>
 class Board {
+public:
+    static constexpr int STRIDE = SIZE + 2;
+    static constexpr int POINTS = STRIDE * STRIDE;
+    
+    using Bits = Bitboard<SIZE>;
+
 private:
-    int grid[BOARD_SIZE][BOARD_SIZE];
+    static constexpr int NEIGHBOR_OFFSETS[4] = {-1, 1, -STRIDE, STRIDE};
+    static constexpr int DIAGONAL_OFFSETS[4] = {-STRIDE - 1, -STRIDE + 1,
+                                                STRIDE - 1, STRIDE + 1};
+    
+    static constexpr int LEGAL_WORDS = (POINTS + 63) / 64;
+    
+    // Chain statistics, stored at the chain's representative stone.
+    // Liberties are pseudo-liberties: an empty point adjacent to k stones of
+    // the chain is counted k times, which keeps every update O(1). A chain
+    // is captured exactly when its count drops to zero. The sum and sum of
+    // squares of the liberty points tell a chain in atari (all pseudo-
+    // liberties are one point) apart from one with several liberties.
+    struct Chain {
+        int size;
+        int liberties;
+        int liberty_sum;
+        int liberty_sum_sq;
+        uint64_t hash;   // XOR of the Zobrist keys of the chain's stones
+    };
+    
+    uint8_t cells[POINTS];
+    uint16_t chain_head[POINTS];         // representative stone of the chain at a point
+    uint16_t chain_next[POINTS];         // circular list of the stones in a chain
+    Chain chains[POINTS];                // valid only at representative stones
     std::optional<Position> ko;
     std::optional<Position> last_move;
+    uint64_t hash;   // Zobrist hash of the stones on the board
+    uint64_t symmetry_hashes[SYMMETRIES - 1];   // the same under symmetries 1-7
+#ifdef GO_BITBOARD_BACKEND
+    Bits stone_bits[2];                  // black and white stones, mirrors cells for get_stones()
+#endif
+
+    // Legal moves for black and white as bitsets over point indices. Every
+    // update queues the points whose legality it may have changed (the
+    // point itself, its neighbors, and the last liberty of any chain going
+    // into or out of atari); only those are re-evaluated afterwards.
+    uint64_t legal_bits[2][LEGAL_WORDS];
+    uint16_t dirty_points[POINTS];
+    int dirty_count;
+    bool dirty[POINTS];
+    // 3x3 pattern code of every point. Neighbor colors are written as
+    // stones come and go; atari bits are refreshed for queued points, since
+    // an atari change always queues the chain's last liberty, the one
+    // point whose code it affects.
+    uint32_t patterns[POINTS];
+    BoardEventHook events;
+    
+    static int point_index(int x, int y) { return (y + 1) * STRIDE + (x + 1); }
+    static Position point_position(int p) { return Position(p % STRIDE - 1, p / STRIDE - 1); }
     
-    std::vector<Position> get_neighbors(int x, int y) const;
-    std::vector<std::vector<Position>> capture_groups(int x, int y, int color);
-    std::vector<Position> get_group(int x, int y) const;
-    bool group_has_liberties(const std::vector<Position>& group) const;
-    bool has_liberties(int x, int y) const;
+    void add_liberty(int head, int p);
+    void remove_liberty(int head, int p);
+    bool chain_in_atari(int head) const;
+    void merge_chains(int a, int b);
+    void place_stone(int p, int color);
+    void remove_chain(int head);
+    void remove_stone(int p);
+    
+    int capture_groups(int p, int color, int* captured_point, std::vector<Position>* removed);
+    int get_group(int p, int* stones) const;
+    bool has_liberties(int p) const;
+    
+    bool is_legal(int p, int color) const;
+    void mark_dirty(int p);
+    void set_pattern_cell(int p, int color);
+    uint32_t pattern_atari_bits(int p) const;
+    void mark_atari_liberty(int head);
+    void refresh_legal_moves();
+    void set_ko(std::optional<Position> point);
 
 public:
     Board();
-    Board(const Board& other);
-    Board& operator=(const Board& other);
+    Board(const Board& other) = default;
+    Board& operator=(const Board& other) = default;
     
     int get(int x, int y) const;
     void set(int x, int y, int color);
+    // Takes the whole chain at (x, y) off the board and returns how many
+    // stones it held, 0 for an empty point. One pass over the chain, where
+    // set() to EMPTY on each stone would lift and re-place the rest.
+    int remove_group(int x, int y);
+    // Empties the board as a new Board would, but stays attached to its
+    // event log
+    void clear();
+    // Reports every later change to log, or to nothing when it is null
+    void set_event_log(BoardEventLog* log);
     
+    // O(1): answered from the legal-move sets, without trying the move
     bool is_valid_move(int x, int y, int color) const;
-    bool make_move(int x, int y, int color);
+    // Stones taken off the board are appended to captured when it is given
+    bool make_move(int x, int y, int color, std::vector<Position>* captured = nullptr);
+    // Takes back the move (x, y): removes that stone, puts the stones it
+    // captured back for the opponent, and restores the previous ko point and
+    // last move. Costs O(stones changed), not a board copy.
+    void undo_move(int x, int y, const std::vector<Position>& captured,
+                   std::optional<Position> previous_ko, std::optional<Position> previous_last_move);
+    
+    std::optional<Position> get_ko() const;
+    std::optional<Position> get_last_move() const;
     
     std::vector<Position> get_valid_moves(int color) const;
+    // Appends the stones of the chain at (x, y) to stones and returns how
+    // many there are, 0 for an empty point
+    int get_group(int x, int y, std::vector<Position>& stones) const;
+    // Writes up to limit (at most 8) distinct liberties of the chain at
+    // (x, y) to liberties and returns how many it found, 0 for an empty
+    // point. Walks the chain only until limit are found; a chain in atari
+    // costs O(1).
+    int get_liberties(int x, int y, int limit, Position* liberties) const;
     int get_territory_owner(int x, int y) const;
+    // True if (x, y) is an empty point surrounded by color that the opponent
+    // cannot break from the diagonals; filling it would only hurt color
+    bool is_eye(int x, int y, int color) const;
+    
+    // Zobrist hash of the stone configuration; ko and side to move are not
+    // included. Equal positions always hash equally, whatever the move order.
+    uint64_t get_hash() const;
+    // Hash the board would have after the valid move (x, y) by color,
+    // including any captures, computed without playing it
+    uint64_t hash_after_move(int x, int y, int color) const;
+    // Hash of the board as it would look after apply_symmetry to every
+    // stone, kept up to date with each stone like get_hash(), which is
+    // symmetry 0
+    uint64_t get_symmetry_hash(int symmetry) const;
+    // Smallest of the eight symmetry hashes, so rotations and mirror images
+    // of a position share it. O(1), for opening books and other tables
+    // keyed by position.
+    uint64_t get_canonical_hash() const;
+    // The symmetry that get_canonical_hash() is the hash of, the lowest one
+    // on a tie. It maps moves on this board to the canonical orientation.
+    int get_canonical_symmetry() const;
+    
+    // 3x3 pattern code of the empty point (x, y), kept up to date move by
+    // move, so reading it is one load. Meaningless for occupied points.
+    uint32_t get_pattern(int x, int y) const { return patterns[point_index(x, y)]; }
+    
+    // Stones of one color as a bitboard, for whole-board queries such as
+    // territory() or stones_without_liberties(). A copy of stone sets kept
+    // move by move in the bitboard backend, a scan of the board otherwise.
+    Bits get_stones(int color) const;
 };
 
 int get_opponent(int color);
 
+bool is_supported_board_size(int size);
+
+// Calls f(std::integral_constant<int, SIZE>()) for the compile-time size
+// equal to size, which must be one of BOARD_SIZES
+template <typename F>
+decltype(auto) dispatch_board_size(int size, F&& f) {
+    switch (size) {
+    case 9:
+        return f(std::integral_constant<int, 9>());
+    case 13:
+        return f(std::integral_constant<int, 13>());
+    default:
+        return f(std::integral_constant<int, 19>());
+    }
+}
+
 #endif // BOARD_H
 
@@ -0,0 +1,449 @@
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "playout.h"
+#include "selfplay.h"
+#include "tactics.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+// Every heap allocation in the process goes through these, so a benchmark
+// can count the allocations its operation makes. The aligned forms count
+// too: transposition table buckets are over-aligned.
+namespace {
+
+std::atomic<long long> allocation_count(0);
+
+void* counted_alloc(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* counted_aligned_alloc(std::size_t size, std::align_val_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+#if defined(_WIN32)
+    void* p = _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc takes whole multiples of the alignment
+    void* p = std::aligned_alloc(align, size ? (size + align - 1) / align * align : align);
+#endif
+    if (p) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void aligned_free(void* p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size) {
+    return counted_alloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return counted_aligned_alloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return counted_aligned_alloc(size, alignment);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    aligned_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    aligned_free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    aligned_free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    aligned_free(p);
+}
+
+namespace {
+
+struct BenchResult {
+    std::string position;
+    std::string operation;
+    long long ops;
+    double ns_per_op;
+    double allocations_per_op;
+};
+
+// Keeps results alive so the compiler cannot drop the work
+volatile long long sink;
+
+// Runs batch() until at least seconds have passed; each call performs
+// ops_per_batch operations
+template <typename F>
+BenchResult measure(const std::string& position, const std::string& operation, double seconds,
+                    long long ops_per_batch, F&& batch) {
+    batch();  // warm-up, and first-call allocations stay out of the count
+    long long ops = 0;
+    long long allocations = allocation_count.load();
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < seconds) {
+        for (int i = 0; i < 8; i++) {
+            batch();
+        }
+        ops += 8 * ops_per_batch;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    allocations = allocation_count.load() - allocations;
+    ops = ops > 0 ? ops : 1;
+    return BenchResult{position, operation, ops, elapsed * 1e9 / ops, (double)allocations / ops};
+}
+
+template <int SIZE>
+struct BenchPosition {
+    std::string name;
+    Game<SIZE> game;
+    std::vector<int16_t> moves;  // as in GameRecord, when made by random play
+    std::vector<Position> timed_moves;  // moves to time, or empty for every legal move
+};
+
+// Plays seeded random moves, as the playouts do, until stop(game) or the
+// end, appending them to moves
+template <int SIZE, typename F>
+void play_random(Game<SIZE>& game, uint64_t seed, std::vector<int16_t>& moves, F&& stop) {
+    RandomPolicy<SIZE> policy;
+    policy.start_game(seed);
+    while (!game.is_game_over() && !stop(game)) {
+        Position move = policy.choose_move(game);
+        game.make_move(move.x, move.y);
+        moves.push_back(move.x < 0 ? (int16_t)-1 : (int16_t)(move.y * SIZE + move.x));
+    }
+}
+
+template <int SIZE>
+int stone_count(const Board<SIZE>& board) {
+    int count = 0;
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            count += board.get(x, y) != EMPTY;
+        }
+    }
+    return count;
+}
+
+// The fixed positions every operation is timed on. Random play is seeded,
+// so they are the same on every run and every machine.
+template <int SIZE>
+std::vector<BenchPosition<SIZE>> make_positions() {
+    std::vector<BenchPosition<SIZE>> positions(4);
+    
+    // Opening: the four corner star points, the center and two approaches
+    positions[0].name = "opening";
+    int edge = SIZE < 13 ? 2 : 3;
+    int far = SIZE - 1 - edge;
+    Position opening[] = {Position(far, edge), Position(edge, far), Position(far, far), Position(edge, edge),
+                          Position(edge + 2, far), Position(far - 2, edge), Position(SIZE / 2, SIZE / 2)};
+    for (const auto& pos : opening) {
+        positions[0].game.make_move(pos.x, pos.y);
+    }
+    
+    // Middle game: random play until 60% of the points hold stones
+    positions[1].name = "middle";
+    play_random(positions[1].game, 2024, positions[1].moves, [](const Game<SIZE>& game) {
+        return stone_count(game.get_board()) * 10 >= SIZE * SIZE * 6;
+    });
+    
+    // Large capture: a white block filling the bottom rows has one liberty
+    // left, in its corner, and Black is to play there
+    positions[2].name = "capture";
+    std::vector<Position> black;
+    std::vector<Position> white;
+    int rows = SIZE / 3;
+    for (int y = SIZE - rows; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            if (x != 0 || y != SIZE - 1) {
+                white.push_back(Position(x, y));
+            }
+        }
+    }
+    for (int x = 0; x < SIZE; x++) {
+        black.push_back(Position(x, SIZE - rows - 1));
+    }
+    positions[2].game.setup(black, white, BLACK);
+    positions[2].timed_moves.push_back(Position(0, SIZE - 1));
+    
+    // Finished: random play to two passes
+    positions[3].name = "finished";
+    play_random(positions[3].game, 7, positions[3].moves, [](const Game<SIZE>&) { return false; });
+    return positions;
+}
+
+template <int SIZE>
+std::vector<BenchResult> run_micro(const BenchPosition<SIZE>& position, double seconds) {
+    std::vector<BenchResult> results;
+    const Game<SIZE>& game = position.game;
+    const Board<SIZE>& board = game.get_board();
+    int color = game.get_current_player();
+    std::vector<Position> moves = position.timed_moves.empty() ? board.get_valid_moves(color) : position.timed_moves;
+    std::vector<Position> stones;
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            if (board.get(x, y) != EMPTY) {
+                stones.push_back(Position(x, y));
+            }
+        }
+    }
+    
+    // Each legal move played and taken back, on a private copy
+    if (!moves.empty()) {
+        Board<SIZE> scratch = board;
+        std::vector<Position> captured;
+        captured.reserve(SIZE * SIZE);
+        results.push_back(measure(position.name, "Board::make_move+undo_move", seconds, (long long)moves.size(), [&]() {
+            for (const auto& move : moves) {
+                std::optional<Position> ko = scratch.get_ko();
+                std::optional<Position> last = scratch.get_last_move();
+                captured.clear();
+                scratch.make_move(move.x, move.y, color, &captured);
+                scratch.undo_move(move.x, move.y, captured, ko, last);
+            }
+            sink = (long long)scratch.get_hash();
+        }));
+    }
+    
+    results.push_back(measure(position.name, "Board::is_valid_move", seconds, SIZE * SIZE, [&]() {
+        long long valid = 0;
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                valid += board.is_valid_move(x, y, color);
+            }
+        }
+        sink = valid;
+    }));
+    
+    results.push_back(measure(position.name, "Board::get_valid_moves", seconds, 1, [&]() {
+        sink = (long long)board.get_valid_moves(color).size();
+    }));
+    
+    if (!stones.empty()) {
+        std::vector<Position> group;
+        group.reserve(SIZE * SIZE);
+        results.push_back(measure(position.name, "Board::get_group", seconds, (long long)stones.size(), [&]() {
+            long long total = 0;
+            for (const auto& stone : stones) {
+                group.clear();
+                total += board.get_group(stone.x, stone.y, group);
+            }
+            sink = total;
+        }));
+    }
+    
+    // Every chain short enough of liberties to be laddered, once each
+    std::vector<Position> short_chains;
+    std::vector<Position> seen;
+    for (const auto& stone : stones) {
+        Position liberties[3];
+        if (board.get_liberties(stone.x, stone.y, 3, liberties) <= 2 &&
+            std::find(seen.begin(), seen.end(), stone) == seen.end()) {
+            short_chains.push_back(stone);
+            board.get_group(stone.x, stone.y, seen);
+        }
+    }
+    if (!short_chains.empty()) {
+        Board<SIZE> scratch = board;
+        TacticalReader<SIZE> reader;
+        results.push_back(measure(position.name, "TacticalReader::is_ladder_captured", seconds,
+                                  (long long)short_chains.size(), [&]() {
+            long long captured = 0;
+            for (const auto& chain : short_chains) {
+                captured += reader.is_ladder_captured(scratch, chain.x, chain.y, color);
+            }
+            sink = captured;
+        }));
+    }
+    
+    results.push_back(measure(position.name, "Board::get_territory_owner", seconds, SIZE * SIZE, [&]() {
+        long long owners = 0;
+        for (int y = 0; y < SIZE; y++) {
+            for (int x = 0; x < SIZE; x++) {
+                owners += board.get_territory_owner(x, y);
+            }
+        }
+        sink = owners;
+    }));
+    
+    // Game keeps a journal, so undo is timed together with the move it undoes
+    if (!moves.empty() && !game.is_game_over()) {
+        Game<SIZE> scratch = game;
+        std::vector<Position> legal;
+        for (const auto& move : moves) {
+            if (scratch.is_valid_move(move.x, move.y)) {
+                legal.push_back(move);
+            }
+        }
+        results.push_back(measure(position.name, "Game::make_move+undo", seconds, (long long)legal.size(), [&]() {
+            for (const auto& move : legal) {
+                scratch.make_move(move.x, move.y);
+                scratch.undo();
+            }
+            sink = scratch.get_current_player();
+        }));
+    }
+    
+    results.push_back(measure(position.name, "Game::calculate_score", seconds, 1, [&]() {
+        sink = game.calculate_score().first;
+    }));
+    return results;
+}
+
+// Whole-game workloads, in moves: a random playout, a full random game
+// through Game with its journal and superko bookkeeping, and replaying a
+// finished game from its record
+template <int SIZE>
+std::vector<BenchResult> run_macro(const BenchPosition<SIZE>& finished, double seconds) {
+    std::vector<BenchResult> results;
+    
+    PlayoutEngine<SIZE> engine(12345);
+    Board<SIZE> empty;
+    int playout_moves = engine.run(empty, BLACK).moves;
+    results.push_back(measure("empty", "PlayoutEngine::run (per move)", seconds, playout_moves, [&]() {
+        sink = engine.run(empty, BLACK).black_score;
+    }));
+    
+    Game<SIZE> game;
+    std::vector<int16_t> moves;
+    moves.reserve(4 * SIZE * SIZE);
+    play_random(game, 1, moves, [](const Game<SIZE>&) { return false; });
+    results.push_back(measure("empty", "Game random game (per move)", seconds, (long long)moves.size(), [&]() {
+        game.reset();
+        moves.clear();
+        play_random(game, 1, moves, [](const Game<SIZE>&) { return false; });
+        sink = (long long)game.get_move_number();
+    }));
+    
+    GameRecord record{};
+    record.board_size = SIZE;
+    record.komi = 7.5;
+    record.moves = finished.moves;
+    Game<SIZE> replay;
+    results.push_back(measure(finished.name, "Game::load (per move)", seconds, (long long)record.moves.size(), [&]() {
+        sink = replay.load(record);
+    }));
+    return results;
+}
+
+void print_json(std::ostream& out, int size, const std::vector<BenchResult>& results) {
+    out << "{\n  \"board_size\": " << size << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "    {\"position\": \"" << r.position << "\", \"operation\": \"" << r.operation
+            << "\", \"ops\": " << r.ops << ", \"ns_per_op\": " << r.ns_per_op
+            << ", \"allocations_per_op\": " << r.allocations_per_op
+            << ", \"ops_per_second\": " << (r.ns_per_op > 0 ? 1e9 / r.ns_per_op : 0.0) << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+template <int SIZE>
+std::vector<BenchResult> run_benchmark(double seconds) {
+    std::vector<BenchPosition<SIZE>> positions = make_positions<SIZE>();
+    std::vector<BenchResult> results;
+    for (const auto& position : positions) {
+        std::vector<BenchResult> micro = run_micro(position, seconds);
+        results.insert(results.end(), micro.begin(), micro.end());
+    }
+    std::vector<BenchResult> macro = run_macro(positions[3], seconds);
+    results.insert(results.end(), macro.begin(), macro.end());
+    return results;
+}
+
+} // namespace
+
+// Headless benchmark suite: times the Board and Game hot paths on fixed
+// positions (opening, dense middle game, a large capture, a finished game)
+// and a few whole-game workloads, reporting ns/op, heap allocations/op and
+// ops/second. --json writes the same numbers for diffing across commits.
+//
+// Usage: GoCoreBench [--seconds S] [--size 9|13|19] [--json FILE]
+int main(int argc, char** argv) {
+    double seconds = 0.2;
+    int size = DEFAULT_BOARD_SIZE;
+    std::string json_path;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--seconds") {
+            seconds = std::atof(argv[i + 1]);
+        } else if (arg == "--size") {
+            size = std::atoi(argv[i + 1]);
+        } else if (arg == "--json") {
+            json_path = argv[i + 1];
+        } else {
+            seconds = -1;
+        }
+    }
+    if (argc % 2 == 0 || seconds <= 0 || !is_supported_board_size(size)) {
+        std::cerr << "Usage: GoCoreBench [--seconds S] [--size 9|13|19] [--json FILE]" << std::endl;
+        return 1;
+    }
+    
+    std::vector<BenchResult> results = dispatch_board_size(size, [&](auto board_size) {
+        return run_benchmark<decltype(board_size)::value>(seconds);
+    });
+    
+    std::cout << size << "x" << size << std::endl;
+    for (const auto& r : results) {
+        std::cout << "  " << r.position << std::string(r.position.size() < 10 ? 10 - r.position.size() : 1, ' ')
+                  << r.operation << std::string(r.operation.size() < 32 ? 32 - r.operation.size() : 1, ' ')
+                  << (long long)(r.ns_per_op * 10) / 10.0 << " ns/op, " << r.allocations_per_op
+                  << " allocs/op, " << (long long)(1e9 / r.ns_per_op) << " ops/s" << std::endl;
+    }
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        print_json(out, size, results);
+        if (!out) {
+            std::cerr << "Cannot write " << json_path << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
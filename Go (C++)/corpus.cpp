@@ -0,0 +1,243 @@
+#include "corpus.h"
+#include "replay.h"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <tuple>
+
+namespace {
+
+constexpr char INDEX_MAGIC[4] = {'G', 'O', 'I', '1'};
+constexpr size_t INDEX_HEADER_BYTES = 24;
+constexpr size_t GAME_ENTRY_BYTES = 16;
+constexpr size_t POSITION_ENTRY_BYTES = 16;
+
+void put(uint8_t* bytes, uint64_t value, int count) {
+    for (int i = 0; i < count; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+uint64_t get(const uint8_t* bytes, int count) {
+    uint64_t value = 0;
+    for (int i = 0; i < count; i++) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+struct GameEntry {
+    uint32_t index;
+    uint64_t offset;
+};
+
+struct PositionEntry {
+    uint64_t hash;
+    uint32_t game;
+    uint32_t move;
+};
+
+// One Game per board size, reused for every record that needs replaying
+using IndexGames = std::tuple<Game<9>, Game<13>, Game<19>>;
+
+// False, with error naming the game and move, if the record does not
+// replay; indexing part of a game would make lookups miss it silently
+template <int SIZE>
+bool replay_hashes(const GameRecord& record, Game<SIZE>& game, std::vector<uint64_t>& hashes, std::string& error) {
+    hashes.clear();
+    if (!game.load(record, 0)) {
+        error = "game " + std::to_string(record.index) + ": setup stones do not load";
+        return false;
+    }
+    for (int16_t point : record.moves) {
+        if (!game.make_move(point < 0 ? -1 : point % SIZE, point < 0 ? -1 : point / SIZE)) {
+            error = "game " + std::to_string(record.index) + ": move " + std::to_string(hashes.size() + 1) +
+                    " is illegal";
+            return false;
+        }
+        hashes.push_back(game.get_board().get_hash());
+    }
+    return true;
+}
+
+} // namespace
+
+GameCorpus::GameCorpus() : games(nullptr), positions(nullptr), game_count(0), position_count(0) {}
+
+bool GameCorpus::open(const std::string& records_path, const std::string& index_path) {
+    game_count = 0;
+    position_count = 0;
+    if (!records.open(records_path) || !is_game_record_stream(records.data(), records.size()) ||
+        !index.open(index_path) || index.size() < INDEX_HEADER_BYTES ||
+        !std::equal(INDEX_MAGIC, INDEX_MAGIC + 4, index.data())) {
+        return false;
+    }
+    const uint8_t* header = (const uint8_t*)index.data();
+    size_t games_in_index = (size_t)get(header + 8, 8);
+    size_t positions_in_index = (size_t)get(header + 16, 8);
+    if (index.size() != INDEX_HEADER_BYTES + games_in_index * GAME_ENTRY_BYTES + positions_in_index * POSITION_ENTRY_BYTES) {
+        return false;
+    }
+    games = header + INDEX_HEADER_BYTES;
+    positions = games + games_in_index * GAME_ENTRY_BYTES;
+    game_count = games_in_index;
+    position_count = positions_in_index;
+    return true;
+}
+
+size_t GameCorpus::get_game_count() const {
+    return game_count;
+}
+
+size_t GameCorpus::get_position_count() const {
+    return position_count;
+}
+
+bool GameCorpus::get_game(uint32_t id, GameRecord& record) const {
+    size_t low = 0;
+    size_t high = game_count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if ((uint32_t)get(games + middle * GAME_ENTRY_BYTES, 4) < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == game_count || (uint32_t)get(games + low * GAME_ENTRY_BYTES, 4) != id) {
+        return false;
+    }
+    size_t offset = (size_t)get(games + low * GAME_ENTRY_BYTES + 8, 8);
+    return offset < records.size() && decode_game_record(records.data() + offset, records.size() - offset, record) > 0;
+}
+
+std::vector<CorpusMatch> GameCorpus::find_position(uint64_t hash, size_t limit) const {
+    size_t low = 0;
+    size_t high = position_count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (get(positions + middle * POSITION_ENTRY_BYTES, 8) < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    std::vector<CorpusMatch> matches;
+    for (size_t i = low; i < position_count && matches.size() < limit; i++) {
+        const uint8_t* entry = positions + i * POSITION_ENTRY_BYTES;
+        if (get(entry, 8) != hash) {
+            break;
+        }
+        matches.push_back(CorpusMatch{(uint32_t)get(entry + 8, 4), (uint32_t)get(entry + 12, 4)});
+    }
+    return matches;
+}
+
+bool build_corpus_index(const std::string& records_path, const std::string& index_path, std::string& error) {
+    MappedFile records;
+    if (!records.open(records_path) || !is_game_record_stream(records.data(), records.size())) {
+        error = records_path + " is not a game record stream";
+        return false;
+    }
+    
+    std::vector<GameEntry> game_entries;
+    std::vector<PositionEntry> position_entries;
+    std::unique_ptr<IndexGames> replay(new IndexGames());
+    GameRecord record;
+    std::vector<uint64_t> hashes;
+    size_t offset = GAME_RECORD_MAGIC_BYTES;
+    while (offset < records.size()) {
+        size_t length = decode_game_record(records.data() + offset, records.size() - offset, record);
+        if (length == 0) {
+            error = "truncated or corrupt record at byte " + std::to_string(offset);
+            return false;
+        }
+        game_entries.push_back(GameEntry{record.index, offset});
+        offset += length;
+        
+        if (record.hashes.empty()) {
+            bool replayed = dispatch_board_size(record.board_size, [&](auto board_size) {
+                return replay_hashes(record, std::get<Game<decltype(board_size)::value>>(*replay), hashes, error);
+            });
+            if (!replayed) {
+                return false;
+            }
+        } else {
+            hashes.swap(record.hashes);
+        }
+        for (size_t move = 0; move < hashes.size(); move++) {
+            position_entries.push_back(PositionEntry{hashes[move], record.index, (uint32_t)move + 1});
+        }
+    }
+    
+    std::sort(game_entries.begin(), game_entries.end(), [](const GameEntry& a, const GameEntry& b) {
+        return a.index != b.index ? a.index < b.index : a.offset < b.offset;
+    });
+    std::sort(position_entries.begin(), position_entries.end(), [](const PositionEntry& a, const PositionEntry& b) {
+        return std::tie(a.hash, a.game, a.move) < std::tie(b.hash, b.game, b.move);
+    });
+    
+    std::ofstream out(index_path, std::ios::binary);
+    uint8_t header[INDEX_HEADER_BYTES] = {};
+    std::copy(INDEX_MAGIC, INDEX_MAGIC + 4, header);
+    put(header + 8, game_entries.size(), 8);
+    put(header + 16, position_entries.size(), 8);
+    out.write((const char*)header, sizeof(header));
+    
+    // Tables go out in blocks of entries rather than one write per entry
+    std::vector<uint8_t> block;
+    for (size_t i = 0; i < game_entries.size(); i++) {
+        uint8_t entry[GAME_ENTRY_BYTES] = {};
+        put(entry, game_entries[i].index, 4);
+        put(entry + 8, game_entries[i].offset, 8);
+        block.insert(block.end(), entry, entry + GAME_ENTRY_BYTES);
+        if (block.size() >= (1 << 20) || i + 1 == game_entries.size()) {
+            out.write((const char*)block.data(), (std::streamsize)block.size());
+            block.clear();
+        }
+    }
+    for (size_t i = 0; i < position_entries.size(); i++) {
+        uint8_t entry[POSITION_ENTRY_BYTES];
+        put(entry, position_entries[i].hash, 8);
+        put(entry + 8, position_entries[i].game, 4);
+        put(entry + 12, position_entries[i].move, 4);
+        block.insert(block.end(), entry, entry + POSITION_ENTRY_BYTES);
+        if (block.size() >= (1 << 20) || i + 1 == position_entries.size()) {
+            out.write((const char*)block.data(), (std::streamsize)block.size());
+            block.clear();
+        }
+    }
+    out.flush();
+    if (!out) {
+        error = "cannot write " + index_path;
+        return false;
+    }
+    return true;
+}
+
+bool record_from_sgf(const SgfGame& sgf, uint32_t index, bool with_hashes, GameRecord& record) {
+    if (!is_supported_board_size(sgf.board_size)) {
+        return false;
+    }
+    record = GameRecord{index, 0, sgf.board_size, sgf.komi, 0, 0, false, {}, {}, {}, sgf.first_player == WHITE, {}, false};
+    return dispatch_board_size(sgf.board_size, [&](auto board_size) {
+        constexpr int SIZE = decltype(board_size)::value;
+        Game<SIZE> game;
+        ReplayOutcome outcome = replay_game(sgf, game, with_hashes ? &record.hashes : nullptr);
+        if (outcome.status != ReplayStatus::Legal) {
+            return false;
+        }
+        for (const auto& pos : sgf.black_setup) {
+            record.black_setup.push_back((int16_t)(pos.y * SIZE + pos.x));
+        }
+        for (const auto& pos : sgf.white_setup) {
+            record.white_setup.push_back((int16_t)(pos.y * SIZE + pos.x));
+        }
+        for (const auto& move : sgf.moves) {
+            record.moves.push_back(move.point.x < 0 ? (int16_t)-1 : (int16_t)(move.point.y * SIZE + move.point.x));
+        }
+        record.black_score = outcome.black_score;
+        record.white_score = outcome.white_score;
+        return true;
+    });
+}
@@ -0,0 +1,65 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include "game_record.h"
+#include "mapped_file.h"
+#include "sgf.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct CorpusMatch {
+    uint32_t game;             // record index
+    uint32_t move;             // the position arises after this many moves
+};
+
+// Random access to a game record stream through the index file written by
+// build_corpus_index(). Both files are memory-mapped and used as they are
+// on disk: opening checks the index header and nothing else, and lookups
+// binary-search the index tables in place.
+//
+// Index layout, all integers little-endian:
+//
+//   "GOI1", u32 0, u64 game count, u64 position count
+//   per game, by index: u32 index, u32 0, u64 byte offset of its record
+//   per position, by hash: u64 board hash, u32 game index, u32 move number
+//
+// A position is the board after a move, stones only: the same shape
+// reached by different move orders, or with the other side to move,
+// matches.
+class GameCorpus {
+private:
+    MappedFile records;
+    MappedFile index;
+    const uint8_t* games;
+    const uint8_t* positions;
+    size_t game_count;
+    size_t position_count;
+
+public:
+    GameCorpus();
+
+    // False if either file is missing, or the index does not fit the records
+    bool open(const std::string& records_path, const std::string& index_path);
+
+    size_t get_game_count() const;
+    size_t get_position_count() const;
+    // Decodes the record with this index straight from the mapping
+    bool get_game(uint32_t id, GameRecord& record) const;
+    // Games and moves that reach the position with this board hash, in
+    // game order, at most limit of them
+    std::vector<CorpusMatch> find_position(uint64_t hash, size_t limit = SIZE_MAX) const;
+};
+
+// Writes the index for a record stream. Position hashes are taken from the
+// records when they store them and found by replaying the moves otherwise;
+// a record that does not replay fails the whole index. On failure error
+// says why.
+bool build_corpus_index(const std::string& records_path, const std::string& index_path, std::string& error);
+
+// The record of a replayable SGF game, with its final area score and, when
+// with_hashes is set, the board hash after each move. False for games
+// replay_game() does not accept as legal.
+bool record_from_sgf(const SgfGame& sgf, uint32_t index, bool with_hashes, GameRecord& record);
+
+#endif // CORPUS_H
@@ -0,0 +1,220 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "corpus.h"
+#include "game.h"
+#include "opening_book.h"
+
+namespace {
+
+void print_usage() {
+    std::cerr << "Usage: GoCorpus convert [--hashes] OUT.gor FILE.sgf...\n"
+                 "       GoCorpus index CORPUS.gor INDEX.goi\n"
+                 "       GoCorpus find CORPUS.gor INDEX.goi GAME MOVE\n"
+                 "       GoCorpus book [--size N] [--moves N] [--min-games N] [--threads N] BOOK.gob CORPUS.gor...\n"
+                 "       GoCorpus lookup BOOK.gob CORPUS.gor INDEX.goi GAME MOVE" << std::endl;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int convert(bool with_hashes, const std::string& out_path, const std::vector<std::string>& paths) {
+    std::ofstream out(out_path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Cannot write " << out_path << std::endl;
+        return 1;
+    }
+    GameRecordWriter writer(out);
+    auto start = std::chrono::steady_clock::now();
+    uint32_t converted = 0;
+    int skipped = 0;
+    size_t sgf_bytes = 0;
+    SgfGame sgf;
+    GameRecord record;
+    for (const auto& path : paths) {
+        MappedFile file;
+        if (!file.open(path)) {
+            std::cerr << "Cannot read " << path << std::endl;
+            return 1;
+        }
+        sgf_bytes += file.size();
+        SgfReader reader(file.data(), file.size());
+        while (reader.next(sgf)) {
+            if (record_from_sgf(sgf, converted, with_hashes, record)) {
+                writer.write(record);
+                converted++;
+            } else {
+                skipped++;
+            }
+        }
+        if (!reader.get_error().empty()) {
+            std::cerr << path << ": " << reader.get_error() << std::endl;
+        }
+    }
+    out.flush();
+    if (!out) {
+        std::cerr << "Error writing " << out_path << std::endl;
+        return 1;
+    }
+    double seconds = seconds_since(start);
+    std::cout << converted << " games converted, " << skipped << " not replayable, in " << seconds << " s; "
+              << sgf_bytes << " bytes of SGF became " << (long long)out.tellp() << " bytes" << std::endl;
+    return 0;
+}
+
+template <int SIZE>
+int find(const GameCorpus& corpus, const GameRecord& record, size_t move) {
+    Game<SIZE> game;
+    if (!game.load(record) || !game.seek(move)) {
+        std::cerr << "Game " << record.index << " has no legal move " << move << std::endl;
+        return 1;
+    }
+    uint64_t hash = game.get_board().get_hash();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<CorpusMatch> matches = corpus.find_position(hash);
+    double seconds = seconds_since(start);
+    std::cout << matches.size() << " positions in " << seconds * 1e6 << " us match game " << record.index
+              << " after move " << move << std::endl;
+    for (size_t i = 0; i < matches.size() && i < 20; i++) {
+        std::cout << "  game " << matches[i].game << ", move " << matches[i].move << std::endl;
+    }
+    return 0;
+}
+
+int book(const std::vector<std::string>& args) {
+    OpeningBookOptions options;
+    size_t first = 1;
+    for (; first + 1 < args.size() && args[first].compare(0, 2, "--") == 0; first += 2) {
+        int value = std::atoi(args[first + 1].c_str());
+        if (args[first] == "--size") {
+            options.board_size = value;
+        } else if (args[first] == "--moves") {
+            options.moves = value;
+        } else if (args[first] == "--min-games") {
+            options.min_games = value;
+        } else if (args[first] == "--threads") {
+            options.threads = value;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (args.size() < first + 2 || options.moves < 0 || options.threads < 0) {
+        print_usage();
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::string error;
+    if (!build_opening_book(std::vector<std::string>(args.begin() + first + 1, args.end()), args[first], options,
+                            error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    OpeningBook opening_book;
+    opening_book.open(args[first]);
+    std::cout << opening_book.get_entry_count() << " book moves written in " << seconds_since(start) << " s"
+              << std::endl;
+    return 0;
+}
+
+template <int SIZE>
+int lookup(const OpeningBook& opening_book, const GameRecord& record, size_t move) {
+    Game<SIZE> game;
+    if (!game.load(record) || !game.seek(move)) {
+        std::cerr << "Game " << record.index << " has no legal move " << move << std::endl;
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BookMove> moves = opening_book.find(game.get_board(), game.get_current_player());
+    double seconds = seconds_since(start);
+    std::cout << moves.size() << " book moves in " << seconds * 1e6 << " us for game " << record.index
+              << " after move " << move << std::endl;
+    for (const auto& book_move : moves) {
+        std::cout << "  (" << book_move.move.x << ", " << book_move.move.y << "): " << book_move.games
+                  << " games, " << book_move.wins << " won" << std::endl;
+    }
+    return 0;
+}
+
+} // namespace
+
+// Headless corpus tool: converts SGF collections to game record streams,
+// indexes a stream by game and by position, and finds every game that
+// reaches the position of a given game after a given move. It also builds
+// opening books from record streams and shows the book moves for a
+// position of an indexed game.
+int main(int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.size() >= 3 && args[0] == "convert") {
+        bool with_hashes = args[1] == "--hashes";
+        size_t first = with_hashes ? 2 : 1;
+        if (args.size() < first + 2) {
+            print_usage();
+            return 1;
+        }
+        return convert(with_hashes, args[first], std::vector<std::string>(args.begin() + first + 1, args.end()));
+    }
+    if (args.size() == 3 && args[0] == "index") {
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        if (!build_corpus_index(args[1], args[2], error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        GameCorpus corpus;
+        corpus.open(args[1], args[2]);
+        std::cout << corpus.get_game_count() << " games, " << corpus.get_position_count() << " positions indexed in "
+                  << seconds_since(start) << " s" << std::endl;
+        return 0;
+    }
+    if (args.size() == 5 && args[0] == "find") {
+        GameCorpus corpus;
+        auto start = std::chrono::steady_clock::now();
+        if (!corpus.open(args[1], args[2])) {
+            std::cerr << "Cannot open " << args[1] << " with index " << args[2] << std::endl;
+            return 1;
+        }
+        std::cout << "opened in " << seconds_since(start) * 1e6 << " us" << std::endl;
+        GameRecord record;
+        if (!corpus.get_game((uint32_t)std::atoll(args[3].c_str()), record) ||
+            !is_supported_board_size(record.board_size)) {
+            std::cerr << "No game " << args[3] << std::endl;
+            return 1;
+        }
+        size_t move = (size_t)std::atoll(args[4].c_str());
+        return dispatch_board_size(record.board_size, [&](auto board_size) {
+            return find<decltype(board_size)::value>(corpus, record, move);
+        });
+    }
+    if (args.size() >= 3 && args[0] == "book") {
+        return book(args);
+    }
+    if (args.size() == 6 && args[0] == "lookup") {
+        OpeningBook opening_book;
+        GameCorpus corpus;
+        if (!opening_book.open(args[1])) {
+            std::cerr << "Cannot open book " << args[1] << std::endl;
+            return 1;
+        }
+        if (!corpus.open(args[2], args[3])) {
+            std::cerr << "Cannot open " << args[2] << " with index " << args[3] << std::endl;
+            return 1;
+        }
+        GameRecord record;
+        if (!corpus.get_game((uint32_t)std::atoll(args[4].c_str()), record) ||
+            !is_supported_board_size(record.board_size)) {
+            std::cerr << "No game " << args[4] << std::endl;
+            return 1;
+        }
+        size_t move = (size_t)std::atoll(args[5].c_str());
+        return dispatch_board_size(record.board_size, [&](auto board_size) {
+            return lookup<decltype(board_size)::value>(opening_book, record, move);
+        });
+    }
+    print_usage();
+    return 1;
+}
@@ -1,49 +1,258 @@
 #include "game.h"
 
-Game::Game() {
-    board = Board();
+namespace {
+
+// XORed into the board hash when White is to move
+constexpr uint64_t WHITE_TO_MOVE_KEY = 0x8F1BBCDCCA62C1D6ULL;
+
+// MoveRecord::move of a turn handed over by skip_turn()
+constexpr int16_t SKIPPED_TURN = -2;
+
+template <int SIZE>
+int16_t pack_point(std::optional<Position> pos) {
+    return pos.has_value() ? (int16_t)(pos->y * SIZE + pos->x) : (int16_t)-1;
+}
+
+template <int SIZE>
+std::optional<Position> unpack_point(int16_t point) {
+    if (point < 0) {
+        return std::nullopt;
+    }
+    return Position(point % SIZE, point / SIZE);
+}
+
+// Setup stones of a record; false if one is a pass or off the board
+template <int SIZE>
+bool unpack_setup(const std::vector<int16_t>& points, std::vector<Position>& stones) {
+    for (int16_t point : points) {
+        if (point < 0 || point >= SIZE * SIZE) {
+            return false;
+        }
+        stones.push_back(Position(point % SIZE, point / SIZE));
+    }
+    return true;
+}
+
+} // namespace
+
+template <int SIZE>
+Game<SIZE>::Game() {
+    board = Board<SIZE>();
     current_player = BLACK;
     black_pass = false;
     white_pass = false;
     game_over = false;
+    history_limit = 0;
+    move_number = 0;
+    ko_rule = KoRule::Simple;
+    position_history.insert(situation_key(board.get_hash(), current_player));
 }
 
-void Game::reset() {
-    board = Board();
+template <int SIZE>
+void Game<SIZE>::reset() {
+    board.clear();
     current_player = BLACK;
     black_pass = false;
     white_pass = false;
     game_over = false;
     history.clear();
+    captured_stones.clear();
+    redo_moves.clear();
+    move_number = 0;
+    regions.rebuild(board);
+    position_history.clear();
+    position_history.insert(situation_key(board.get_hash(), current_player));
 }
 
-void Game::save_state() {
-    history.push_back(GameState(board, current_player, black_pass, white_pass, game_over));
+template <int SIZE>
+void Game<SIZE>::setup(const std::vector<Position>& black, const std::vector<Position>& white, int to_move) {
+    reset();
+    for (const auto& pos : black) {
+        board.set(pos.x, pos.y, BLACK);
+    }
+    for (const auto& pos : white) {
+        board.set(pos.x, pos.y, WHITE);
+    }
+    current_player = to_move;
+    regions.rebuild(board);
+    position_history.clear();
+    position_history.insert(situation_key(board.get_hash(), current_player));
 }
 
-bool Game::undo() {
+template <int SIZE>
+bool Game<SIZE>::load(const GameRecord& record, size_t max_moves) {
+    if (record.board_size != SIZE) {
+        return false;
+    }
+    std::vector<Position> black;
+    std::vector<Position> white;
+    if (!unpack_setup<SIZE>(record.black_setup, black) || !unpack_setup<SIZE>(record.white_setup, white)) {
+        return false;
+    }
+    setup(black, white, record.white_first ? WHITE : BLACK);
+    
+    for (size_t i = 0; i < record.moves.size() && i < max_moves; i++) {
+        std::optional<Position> move = unpack_point<SIZE>(record.moves[i]);
+        if (!make_move(move ? move->x : -1, move ? move->y : -1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <int SIZE>
+bool Game<SIZE>::seek(size_t move) {
+    while (move_number > move) {
+        if (!undo()) {
+            return false;
+        }
+    }
+    while (move_number < move) {
+        if (!redo()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <int SIZE>
+size_t Game<SIZE>::get_move_number() const {
+    return move_number;
+}
+
+template <int SIZE>
+void Game<SIZE>::trim_history() {
+    // Forget the oldest moves, and the stones they captured, past the limit
+    while (history_limit > 0 && history.size() > history_limit) {
+        captured_stones.erase(captured_stones.begin(), captured_stones.begin() + history.front().captured_count);
+        history.pop_front();
+    }
+}
+
+template <int SIZE>
+void Game<SIZE>::set_history_limit(size_t max_moves) {
+    history_limit = max_moves;
+    trim_history();
+}
+
+template <int SIZE>
+uint64_t Game<SIZE>::situation_key(uint64_t board_hash, int player) {
+    return player == WHITE ? board_hash ^ WHITE_TO_MOVE_KEY : board_hash;
+}
+
+template <int SIZE>
+bool Game<SIZE>::undo() {
     if (history.empty()) {
         return false;
     }
-    GameState state = history.back();
+    auto current = position_history.find(situation_key(board.get_hash(), current_player));
+    if (current != position_history.end()) {
+        position_history.erase(current);
+    }
+    MoveRecord record = history.back();
     history.pop_back();
-    board = state.board;
-    current_player = state.current_player;
-    black_pass = state.black_pass;
-    white_pass = state.white_pass;
-    game_over = state.game_over;
+    
+    std::optional<Position> move = unpack_point<SIZE>(record.move);
+    if (move.has_value()) {
+        capture_buffer.clear();
+        for (auto it = captured_stones.end() - record.captured_count; it != captured_stones.end(); ++it) {
+            capture_buffer.push_back(*unpack_point<SIZE>(*it));
+        }
+        captured_stones.erase(captured_stones.end() - record.captured_count, captured_stones.end());
+        board.undo_move(move->x, move->y, capture_buffer,
+                        unpack_point<SIZE>(record.previous_ko), unpack_point<SIZE>(record.previous_last_move));
+        capture_buffer.push_back(*move);
+        regions.update(board, capture_buffer);
+    }
+    current_player = get_opponent(current_player);
+    black_pass = record.black_pass;
+    white_pass = record.white_pass;
+    game_over = record.game_over;
+    redo_moves.push_back(record.move);
+    move_number--;
+    return true;
+}
+
+template <int SIZE>
+bool Game<SIZE>::redo() {
+    if (redo_moves.empty()) {
+        return false;
+    }
+    std::optional<Position> move = unpack_point<SIZE>(redo_moves.back());
+    if (redo_moves.back() == SKIPPED_TURN ? !skip() : !play(move ? move->x : -1, move ? move->y : -1)) {
+        return false;
+    }
+    redo_moves.pop_back();
     return true;
 }
 
-bool Game::make_move(int x, int y) {
+template <int SIZE>
+bool Game<SIZE>::make_move(int x, int y) {
+    if (!play(x, y)) {
+        return false;
+    }
+    // A new move starts a new line of play
+    redo_moves.clear();
+    return true;
+}
+
+template <int SIZE>
+bool Game<SIZE>::skip_turn() {
+    if (!skip()) {
+        return false;
+    }
+    redo_moves.clear();
+    return true;
+}
+
+template <int SIZE>
+MoveRecord Game<SIZE>::start_record(int16_t move) const {
+    // Journal what the move is about to change
+    MoveRecord record;
+    record.move = move;
+    record.previous_ko = pack_point<SIZE>(board.get_ko());
+    record.previous_last_move = pack_point<SIZE>(board.get_last_move());
+    record.captured_count = 0;
+    record.black_pass = black_pass;
+    record.white_pass = white_pass;
+    record.game_over = game_over;
+    return record;
+}
+
+template <int SIZE>
+void Game<SIZE>::end_turn(const MoveRecord& record) {
+    current_player = get_opponent(current_player);
+    position_history.insert(situation_key(board.get_hash(), current_player));
+    history.push_back(record);
+    move_number++;
+    trim_history();
+}
+
+template <int SIZE>
+bool Game<SIZE>::skip() {
+    if (game_over) {
+        return false;
+    }
+    // Leaves the pass flags alone, so neither side has passed for it
+    end_turn(start_record(SKIPPED_TURN));
+    return true;
+}
+
+template <int SIZE>
+bool Game<SIZE>::play(int x, int y) {
     if (game_over) {
         return false;
     }
     
-    // Save state before making move
-    save_state();
+    // Superko needs the resulting position, so check it before touching anything
+    bool is_pass = x < 0 || y < 0;
+    if (!is_pass && ko_rule != KoRule::Simple && !is_valid_move(x, y)) {
+        return false;
+    }
+    
+    MoveRecord record = start_record(is_pass ? (int16_t)-1 : (int16_t)(y * SIZE + x));
     
-    if (x < 0 || y < 0) {
+    if (is_pass) {
         // Pass move
         if (current_player == BLACK) {
             black_pass = true;
@@ -54,42 +263,85 @@ bool Game::make_move(int x, int y) {
         if (black_pass && white_pass) {
             game_over = true;
         }
-        current_player = get_opponent(current_player);
+        end_turn(record);
         return true;
     }
     
-    if (board.make_move(x, y, current_player)) {
+    capture_buffer.clear();
+    if (board.make_move(x, y, current_player, &capture_buffer)) {
+        for (const auto& pos : capture_buffer) {
+            captured_stones.push_back(pack_point<SIZE>(pos));
+        }
+        record.captured_count = (uint16_t)capture_buffer.size();
+        capture_buffer.push_back(Position(x, y));
+        regions.update(board, capture_buffer);
         if (current_player == BLACK) {
             black_pass = false;
         } else {
             white_pass = false;
         }
-        current_player = get_opponent(current_player);
+        end_turn(record);
         return true;
     }
     
-    // If move failed, remove the saved state
-    history.pop_back();
     return false;
 }
 
-int Game::get_current_player() const {
+template <int SIZE>
+bool Game<SIZE>::is_valid_move(int x, int y) const {
+    if (game_over || !board.is_valid_move(x, y, current_player)) {
+        return false;
+    }
+    if (ko_rule == KoRule::Simple) {
+        return true;
+    }
+    
+    // One hash lookup per candidate: the resulting position must be new
+    uint64_t next = board.hash_after_move(x, y, current_player);
+    if (ko_rule == KoRule::Situational) {
+        int next_player = get_opponent(current_player);
+        return position_history.find(situation_key(next, next_player)) == position_history.end();
+    }
+    return position_history.find(situation_key(next, BLACK)) == position_history.end() &&
+           position_history.find(situation_key(next, WHITE)) == position_history.end();
+}
+
+template <int SIZE>
+void Game<SIZE>::set_ko_rule(KoRule rule) {
+    ko_rule = rule;
+}
+
+template <int SIZE>
+KoRule Game<SIZE>::get_ko_rule() const {
+    return ko_rule;
+}
+
+template <int SIZE>
+int Game<SIZE>::get_current_player() const {
     return current_player;
 }
 
-const Board& Game::get_board() const {
+template <int SIZE>
+const Board<SIZE>& Game<SIZE>::get_board() const {
     return board;
 }
 
-bool Game::is_game_over() const {
+template <int SIZE>
+void Game<SIZE>::set_event_log(BoardEventLog* log) {
+    board.set_event_log(log);
+}
+
+template <int SIZE>
+bool Game<SIZE>::is_game_over() const {
     return game_over;
 }
 
-std::vector<std::vector<int>> Game::get_board_state() const {
+template <int SIZE>
+std::vector<std::vector<int>> Game<SIZE>::get_board_state() const {
     std::vector<std::vector<int>> state;
-    for (int y = 0; y < BOARD_SIZE; y++) {
+    for (int y = 0; y < SIZE; y++) {
         std::vector<int> row;
-        for (int x = 0; x < BOARD_SIZE; x++) {
+        for (int x = 0; x < SIZE; x++) {
             row.push_back(board.get(x, y));
         }
         state.push_back(row);
@@ -97,32 +349,19 @@ std::vector<std::vector<int>> Game::get_board_state() const {
     return state;
 }
 
-std::pair<int, int> Game::calculate_score() const {
+template <int SIZE>
+std::pair<int, int> Game<SIZE>::calculate_score() const {
     // Returns (black_score, white_score)
-    // Using area scoring: stones on board + controlled territory
-    int black_score = 0;
-    int white_score = 0;
-    
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            int cell = board.get(x, y);
-            if (cell == BLACK) {
-                black_score += 1;
-            } else if (cell == WHITE) {
-                white_score += 1;
-            } else if (cell == EMPTY) {
-                // Check which player controls this empty space
-                int controlled_by = board.get_territory_owner(x, y);
-                if (controlled_by == BLACK) {
-                    black_score += 1;
-                } else if (controlled_by == WHITE) {
-                    white_score += 1;
-                }
-                // Neutral territory doesn't count
-            }
-        }
-    }
-    
-    return std::make_pair(black_score, white_score);
+    // Using area scoring: stones on board + controlled territory. The region
+    // map already holds both totals, so this is O(1).
+    return regions.score();
+}
+
+template <int SIZE>
+const RegionMap<SIZE>& Game<SIZE>::get_regions() const {
+    return regions;
 }
 
+template class Game<9>;
+template class Game<13>;
+template class Game<19>;
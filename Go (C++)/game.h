@@ -2,41 +2,95 @@
 #define GAME_H
 
 #include "board.h"
+#include "score.h"
+#include "game_record.h"
 #include <vector>
+#include <deque>
+#include <unordered_set>
 
-struct GameState {
-    Board board;
-    int current_player;
-    bool black_pass;
+enum class KoRule {
+    Simple,       // only the immediate recapture of a single stone is forbidden
+    Positional,   // no move may recreate any earlier board position
+    Situational   // no move may recreate an earlier position with the same player to move
+};
+
+// One undo-journal entry. Rather than a board snapshot it keeps only what
+// the move changed; points are packed as y * SIZE + x, or -1 for none.
+struct MoveRecord {
+    int16_t move;                 // -1 for a pass, -2 for a skipped turn
+    int16_t previous_ko;
+    int16_t previous_last_move;
+    uint16_t captured_count;      // stones at the back of Game::captured_stones
+    bool black_pass;              // pass and game-over flags before the move
     bool white_pass;
     bool game_over;
-    
-    GameState(const Board& b, int cp, bool bp, bool wp, bool go)
-        : board(b), current_player(cp), black_pass(bp), white_pass(wp), game_over(go) {}
 };
 
+template <int SIZE>
 class Game {
 private:
-    Board board;
+    Board<SIZE> board;
     int current_player;
     bool black_pass;
     bool white_pass;
     bool game_over;
-    std::vector<GameState> history;
+    std::deque<MoveRecord> history;
+    std::deque<int16_t> captured_stones;   // stones captured by the moves in history
+    std::vector<int16_t> redo_moves;       // undone moves packed as in MoveRecord, most recent last
+    std::vector<Position> capture_buffer;  // scratch space, reused across moves
+    size_t history_limit;                  // 0 keeps every move
+    size_t move_number;                    // moves played since the start position
+    KoRule ko_rule;
+    RegionMap<SIZE> regions;               // empty regions, updated move by move
+    // Every position reached so far, keyed by board hash and player to move
+    std::unordered_multiset<uint64_t> position_history;
     
-    void save_state();
+    bool play(int x, int y);
+    MoveRecord start_record(int16_t move) const;
+    void end_turn(const MoveRecord& record);
+    bool skip();
+    void trim_history();
+    static uint64_t situation_key(uint64_t board_hash, int player);
 
 public:
     Game();
     
     void reset();
+    // Start from the empty board with these stones already placed, as for
+    // handicap stones or an SGF root with AB/AW, and to_move to play
+    void setup(const std::vector<Position>& black, const std::vector<Position>& white, int to_move);
+    // Starts from a record's setup and plays its first max_moves moves.
+    // False if the record is for another board size, has a setup stone off
+    // the board or a move is illegal; the game then stops at the move
+    // before.
+    bool load(const GameRecord& record, size_t max_moves = SIZE_MAX);
+    // Undoes or redoes to move number move, so after load() any position
+    // of the record is a few undo steps away. False if history_limit has
+    // dropped the moves needed to get there.
+    bool seek(size_t move);
+    size_t get_move_number() const;
     bool undo();
+    bool redo();
+    // Keep only the last max_moves moves undoable (0 = no limit), so history
+    // memory stays bounded in long games
+    void set_history_limit(size_t max_moves);
     bool make_move(int x, int y);
+    // Gives the move to the opponent without playing, as when GTP has one
+    // color move twice in a row. Unlike a pass it never ends the game.
+    // Undone and redone like a move; false once the game is over.
+    bool skip_turn();
+    bool is_valid_move(int x, int y) const;
+    void set_ko_rule(KoRule rule);
+    KoRule get_ko_rule() const;
     int get_current_player() const;
-    const Board& get_board() const;
+    const Board<SIZE>& get_board() const;
+    // Attaches log to the game's board (see Board::set_event_log), so it
+    // follows every move, undo, redo and reset
+    void set_event_log(BoardEventLog* log);
     bool is_game_over() const;
     std::vector<std::vector<int>> get_board_state() const;
     std::pair<int, int> calculate_score() const; // Returns (black_score, white_score)
+    const RegionMap<SIZE>& get_regions() const;  // Territory map and per-region ownership
 };
 
 #endif // GAME_H
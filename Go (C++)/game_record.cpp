@@ -0,0 +1,212 @@
+#include "game_record.h"
+#include "board.h"
+#include <cmath>
+
+namespace {
+
+constexpr char MAGIC[4] = {'G', 'O', 'R', '1'};
+constexpr size_t HEADER_BYTES = 24;
+constexpr size_t SETUP_COUNT_BYTES = 4;
+constexpr uint16_t PASS_CODE = 0xFFFF;
+
+constexpr uint8_t FLAG_MOVE_LIMIT = 1;
+constexpr uint8_t FLAG_HASHES = 2;
+constexpr uint8_t FLAG_SETUP = 4;
+constexpr uint8_t FLAG_WHITE_FIRST = 8;
+constexpr uint8_t FLAG_SCORE_ESTIMATED = 16;
+
+void put(uint8_t* bytes, uint64_t value, int count) {
+    for (int i = 0; i < count; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+uint64_t get(const uint8_t* bytes, int count) {
+    uint64_t value = 0;
+    for (int i = 0; i < count; i++) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+uint8_t* put_points(uint8_t* p, const std::vector<int16_t>& points) {
+    for (int16_t point : points) {
+        put(p, point < 0 ? PASS_CODE : (uint16_t)point, 2);
+        p += 2;
+    }
+    return p;
+}
+
+const uint8_t* get_points(const uint8_t* p, size_t count, std::vector<int16_t>& points) {
+    points.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        uint16_t code = (uint16_t)get(p, 2);
+        points[i] = code == PASS_CODE ? (int16_t)-1 : (int16_t)code;
+        p += 2;
+    }
+    return p;
+}
+
+// True if every point is on a board_size board, or a pass where passes
+// are allowed
+bool points_on_board(const std::vector<int16_t>& points, int board_size, bool allow_pass) {
+    for (int16_t point : points) {
+        if (point < (allow_pass ? -1 : 0) || point >= board_size * board_size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Length of the record at bytes, from its header and setup counts; 0 when
+// available does not reach far enough to tell
+size_t record_size(const uint8_t* bytes, size_t available) {
+    if (available < HEADER_BYTES) {
+        return 0;
+    }
+    uint8_t flags = bytes[13];
+    size_t moves = (size_t)get(bytes + 20, 4);
+    size_t size = HEADER_BYTES + 2 * moves;
+    if (flags & FLAG_HASHES) {
+        size += 8 * moves;
+    }
+    if (flags & FLAG_SETUP) {
+        if (available < HEADER_BYTES + SETUP_COUNT_BYTES) {
+            return 0;
+        }
+        size += SETUP_COUNT_BYTES + 2 * (get(bytes + HEADER_BYTES, 2) + get(bytes + HEADER_BYTES + 2, 2));
+    }
+    return size;
+}
+
+} // namespace
+
+GameRecordWriter::GameRecordWriter(std::ostream& out) : out(out) {
+    out.write(MAGIC, sizeof(MAGIC));
+}
+
+void GameRecordWriter::write(const GameRecord& record) {
+    bool has_setup = !record.black_setup.empty() || !record.white_setup.empty();
+    bool has_hashes = !record.hashes.empty() && record.hashes.size() == record.moves.size();
+    uint8_t flags = (record.move_limit ? FLAG_MOVE_LIMIT : 0) | (has_hashes ? FLAG_HASHES : 0) |
+                    (has_setup ? FLAG_SETUP : 0) | (record.white_first ? FLAG_WHITE_FIRST : 0) |
+                    (record.score_estimated ? FLAG_SCORE_ESTIMATED : 0);
+    
+    // The whole record goes out in one write
+    size_t size = HEADER_BYTES + 2 * record.moves.size();
+    if (has_setup) {
+        size += SETUP_COUNT_BYTES + 2 * (record.black_setup.size() + record.white_setup.size());
+    }
+    if (has_hashes) {
+        size += 8 * record.hashes.size();
+    }
+    std::vector<uint8_t> bytes(size);
+    uint8_t* p = bytes.data();
+    put(p, record.index, 4);
+    put(p + 4, record.seed, 8);
+    put(p + 12, (uint64_t)record.board_size, 1);
+    put(p + 13, flags, 1);
+    put(p + 14, (uint16_t)(int16_t)std::lround(record.komi * 2), 2);
+    put(p + 16, (uint16_t)(int16_t)record.black_score, 2);
+    put(p + 18, (uint16_t)(int16_t)record.white_score, 2);
+    put(p + 20, (uint64_t)record.moves.size(), 4);
+    p += HEADER_BYTES;
+    if (has_setup) {
+        put(p, record.black_setup.size(), 2);
+        put(p + 2, record.white_setup.size(), 2);
+        p = put_points(p + SETUP_COUNT_BYTES, record.black_setup);
+        p = put_points(p, record.white_setup);
+    }
+    p = put_points(p, record.moves);
+    if (has_hashes) {
+        for (uint64_t hash : record.hashes) {
+            put(p, hash, 8);
+            p += 8;
+        }
+    }
+    out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+}
+
+GameRecordReader::GameRecordReader(std::istream& in) : in(in) {
+    char magic[4];
+    valid = in.read(magic, sizeof(magic)) && is_game_record_stream(magic, sizeof(magic));
+}
+
+bool GameRecordReader::read(GameRecord& record) {
+    buffer.resize(HEADER_BYTES);
+    if (!valid || !in.read((char*)buffer.data(), HEADER_BYTES)) {
+        return false;
+    }
+    // Setup counts sit past the fixed header; read them to learn the length
+    if (buffer[13] & FLAG_SETUP) {
+        buffer.resize(HEADER_BYTES + SETUP_COUNT_BYTES);
+        if (!in.read((char*)buffer.data() + HEADER_BYTES, SETUP_COUNT_BYTES)) {
+            valid = false;
+            return false;
+        }
+    }
+    size_t have = buffer.size();
+    buffer.resize(record_size(buffer.data(), have));
+    if (buffer.size() > have && !in.read((char*)buffer.data() + have, (std::streamsize)(buffer.size() - have))) {
+        valid = false;
+        return false;
+    }
+    return decode_game_record((const char*)buffer.data(), buffer.size(), record) > 0;
+}
+
+bool GameRecordReader::is_valid() const {
+    return valid;
+}
+
+bool is_game_record_stream(const char* bytes, size_t size) {
+    return size >= sizeof(MAGIC) && bytes[0] == MAGIC[0] && bytes[1] == MAGIC[1] && bytes[2] == MAGIC[2] &&
+           bytes[3] == MAGIC[3];
+}
+
+size_t decode_game_record(const char* bytes, size_t size, GameRecord& record) {
+    const uint8_t* header = (const uint8_t*)bytes;
+    size_t length = record_size(header, size);
+    if (length == 0 || length > size) {
+        return 0;
+    }
+    uint8_t flags = header[13];
+    record.index = (uint32_t)get(header, 4);
+    record.seed = get(header + 4, 8);
+    record.board_size = (int)header[12];
+    record.move_limit = (flags & FLAG_MOVE_LIMIT) != 0;
+    record.white_first = (flags & FLAG_WHITE_FIRST) != 0;
+    record.score_estimated = (flags & FLAG_SCORE_ESTIMATED) != 0;
+    record.komi = (int16_t)get(header + 14, 2) / 2.0;
+    record.black_score = (int16_t)get(header + 16, 2);
+    record.white_score = (int16_t)get(header + 18, 2);
+    
+    size_t moves = (size_t)get(header + 20, 4);
+    const uint8_t* p = header + HEADER_BYTES;
+    if (flags & FLAG_SETUP) {
+        size_t black = (size_t)get(p, 2);
+        size_t white = (size_t)get(p + 2, 2);
+        p = get_points(p + SETUP_COUNT_BYTES, black, record.black_setup);
+        p = get_points(p, white, record.white_setup);
+    } else {
+        record.black_setup.clear();
+        record.white_setup.clear();
+    }
+    p = get_points(p, moves, record.moves);
+    // Readers index boards with these points, so a corrupt record must not
+    // get past here
+    if (!is_supported_board_size(record.board_size) ||
+        !points_on_board(record.black_setup, record.board_size, false) ||
+        !points_on_board(record.white_setup, record.board_size, false) ||
+        !points_on_board(record.moves, record.board_size, true)) {
+        return 0;
+    }
+    record.hashes.clear();
+    if (flags & FLAG_HASHES) {
+        record.hashes.resize(moves);
+        for (size_t i = 0; i < moves; i++) {
+            record.hashes[i] = get(p, 8);
+            p += 8;
+        }
+    }
+    return length;
+}
@@ -0,0 +1,77 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <cstdint>
+
+// A finished game in the form the batch tools store it
+struct GameRecord {
+    uint32_t index;              // game number within its batch
+    uint64_t seed;               // seed the game was played with
+    int board_size;
+    double komi;                 // whole or half points
+    int black_score;             // area score of the final position
+    int white_score;
+    bool move_limit;             // stopped at the move cap, not by two passes
+    std::vector<int16_t> moves;  // y * board_size + x, or -1 for a pass
+    std::vector<int16_t> black_setup;  // stones on the board before the first move
+    std::vector<int16_t> white_setup;
+    bool white_first;            // White plays the first move
+    std::vector<uint64_t> hashes;  // optional: board hash after each move
+    bool score_estimated;        // ended early and scored by estimate_final_score
+};
+
+// Compact binary stream of game records. The stream starts with the magic
+// "GOR1"; each record is a fixed 24-byte header followed by two bytes per
+// move, about a tenth of the same game in SGF. All integers are
+// little-endian:
+//
+//   u32 index, u64 seed, u8 board_size, u8 flags, i16 komi in half points,
+//   i16 black_score, i16 white_score, u32 move count
+//   flags bit 2: u16 black and u16 white setup stone counts, then u16 per
+//                setup stone, black first
+//   u16 per move (0xFFFF for a pass)
+//   flags bit 1: u64 per move, the board hash after it
+//
+// A record is therefore self-delimiting, and decode_game_record() can read
+// one in place, for example from a memory-mapped corpus. The other flags
+// are bit 0 move_limit, bit 3 white_first and bit 4 score_estimated.
+class GameRecordWriter {
+private:
+    std::ostream& out;
+
+public:
+    // Writes the stream header
+    explicit GameRecordWriter(std::ostream& out);
+
+    void write(const GameRecord& record);
+};
+
+class GameRecordReader {
+private:
+    std::istream& in;
+    bool valid;
+    std::vector<uint8_t> buffer;
+
+public:
+    // Reads and checks the stream header
+    explicit GameRecordReader(std::istream& in);
+
+    // False at the end of the stream, or if the header or a record is bad
+    bool read(GameRecord& record);
+    bool is_valid() const;
+};
+
+// Bytes of the stream header that starts every record stream
+constexpr size_t GAME_RECORD_MAGIC_BYTES = 4;
+
+// Checks the stream header at the start of bytes
+bool is_game_record_stream(const char* bytes, size_t size);
+// Decodes the record at the start of bytes and returns its length, or 0 if
+// size is too short for it, its board size is not one of BOARD_SIZES or a
+// setup stone or move lies off the board
+size_t decode_game_record(const char* bytes, size_t size, GameRecord& record);
+
+#endif // GAME_RECORD_H
@@ -0,0 +1,556 @@
+#include "gtp.h"
+#include "mcts.h"
+#include "opening_book.h"
+#include "ownership.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* const COMMANDS[] = {
+    "protocol_version", "name", "version", "known_command", "list_commands", "quit",
+    "boardsize", "clear_board", "komi", "play", "genmove", "undo", "final_score",
+    "time_settings", "time_left", "showboard"
+};
+
+// Commands that change nothing a search depends on, so a ponder search
+// keeps running through them
+const char* const PASSIVE_COMMANDS[] = {
+    "protocol_version", "name", "version", "known_command", "list_commands",
+    "time_settings", "time_left", "showboard"
+};
+
+// GTP columns skip I
+constexpr char COLUMNS[] = "ABCDEFGHJKLMNOPQRST";
+
+// A ponder search runs until the next command interrupts it
+constexpr double PONDER_SECONDS = 24 * 60 * 60;
+
+// Held back from every move's time for reading the command and writing
+// the answer
+constexpr double TIME_MARGIN = 0.1;
+
+bool contains(const char* const* names, size_t count, const std::string& name) {
+    return std::find(names, names + count, name) != names + count;
+}
+
+std::string to_lower(std::string text) {
+    for (auto& c : text) {
+        c = (char)std::tolower((unsigned char)c);
+    }
+    return text;
+}
+
+bool parse_color(const std::string& text, int& color) {
+    std::string name = to_lower(text);
+    if (name == "b" || name == "black") {
+        color = BLACK;
+    } else if (name == "w" || name == "white") {
+        color = WHITE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Vertices are a column letter and a row number counted from the bottom;
+// "pass" is (-1, -1)
+bool parse_vertex(const std::string& text, int size, Position& vertex) {
+    std::string name = to_lower(text);
+    if (name == "pass") {
+        vertex = Position(-1, -1);
+        return true;
+    }
+    if (name.size() < 2 || name[0] == 'i') {
+        return false;
+    }
+    const char* column = std::find(COLUMNS, COLUMNS + size, (char)std::toupper((unsigned char)name[0]));
+    int row = 0;
+    for (size_t i = 1; i < name.size(); i++) {
+        if (!std::isdigit((unsigned char)name[i])) {
+            return false;
+        }
+        row = row * 10 + (name[i] - '0');
+        if (row > size) {
+            return false;
+        }
+    }
+    if (column == COLUMNS + size || row < 1) {
+        return false;
+    }
+    vertex = Position((int)(column - COLUMNS), size - row);
+    return true;
+}
+
+std::string format_vertex(Position vertex, int size) {
+    if (vertex.x < 0 || vertex.y < 0) {
+        return "pass";
+    }
+    return COLUMNS[vertex.x] + std::to_string(size - vertex.y);
+}
+
+} // namespace
+
+// The game and search for one board size, behind a size-independent
+// interface so GtpEngine can swap it on boardsize
+class GtpSession {
+public:
+    virtual ~GtpSession() = default;
+    
+    virtual int get_size() const = 0;
+    virtual int get_move_number() const = 0;
+    virtual void clear() = 0;
+    virtual void set_komi(double komi) = 0;
+    // Plays move for color, skipping the other color's turn first if it is
+    // to move
+    virtual bool play(int color, Position move) = 0;
+    // Searches and plays a move for color; returns false to resign
+    virtual bool generate(int color, double seconds, Position& move) = 0;
+    virtual bool undo() = 0;
+    virtual std::string final_score() const = 0;
+    virtual std::string show() const = 0;
+    virtual void start_ponder() = 0;
+    virtual void stop_ponder() = 0;
+};
+
+namespace {
+
+template <int SIZE>
+class SizedGtpSession : public GtpSession {
+private:
+    GtpConfig config;
+    const OpeningBook* book;            // null without one
+    Game<SIZE> game;
+    std::unique_ptr<MctsSearch<SIZE>> search;
+    std::vector<int> command_moves;     // game moves made by each play and genmove, for undo
+    std::unique_ptr<Game<SIZE>> ponder_game;
+    std::thread ponder_thread;
+    
+    void create_search() {
+        SearchConfig search_config;
+        search_config.threads = config.threads;
+        search_config.seconds = config.seconds;
+        search_config.max_playouts = config.playouts;
+        search_config.komi = config.komi;
+        search.reset(new MctsSearch<SIZE>(search_config));
+    }
+    
+    // GTP lets either color move at any time. A move for the color not to
+    // move follows a skipped turn, which unlike a pass never ends the game.
+    bool turn_to(int color, int& made) {
+        made = 0;
+        if (color != game.get_current_player()) {
+            if (!game.skip_turn()) {
+                return false;
+            }
+            made = 1;
+        }
+        return true;
+    }
+
+public:
+    SizedGtpSession(const GtpConfig& config, const OpeningBook* book) : config(config), book(book) {
+        create_search();
+    }
+    
+    ~SizedGtpSession() override {
+        stop_ponder();
+    }
+    
+    int get_size() const override {
+        return SIZE;
+    }
+    
+    int get_move_number() const override {
+        return (int)game.get_move_number();
+    }
+    
+    void clear() override {
+        game.reset();
+        search->clear();
+        command_moves.clear();
+    }
+    
+    void set_komi(double komi) override {
+        // The komi is part of every stored win rate, so the tree goes too
+        config.komi = komi;
+        create_search();
+    }
+    
+    bool play(int color, Position move) override {
+        int made;
+        if (!turn_to(color, made)) {
+            return false;
+        }
+        if (!game.make_move(move.x, move.y)) {
+            if (made > 0) {
+                game.undo();
+            }
+            return false;
+        }
+        command_moves.push_back(made + 1);
+        return true;
+    }
+    
+    bool generate(int color, double seconds, Position& move) override {
+        int made;
+        if (!turn_to(color, made)) {
+            move = Position(-1, -1);
+            return true;
+        }
+        // A book move costs one lookup instead of the whole move time
+        if (book) {
+            std::vector<BookMove> moves = book->find(game.get_board(), color);
+            if (!moves.empty() && game.make_move(moves[0].move.x, moves[0].move.y)) {
+                move = moves[0].move;
+                command_moves.push_back(made + 1);
+                return true;
+            }
+        }
+        search->set_limits(seconds, config.playouts);
+        SearchResult result = search->search(game);
+        if (config.resign_win_rate > 0 && !result.moves.empty() &&
+            result.moves[0].win_rate < config.resign_win_rate) {
+            if (made > 0) {
+                game.undo();
+            }
+            return false;
+        }
+        move = result.best_move;
+        if (!game.make_move(move.x, move.y)) {
+            move = Position(-1, -1);
+            if (!game.make_move(-1, -1)) {
+                // Nothing is left to play once the game is over
+                if (made > 0) {
+                    command_moves.push_back(made);
+                }
+                return true;
+            }
+        }
+        command_moves.push_back(made + 1);
+        return true;
+    }
+    
+    bool undo() override {
+        if (command_moves.empty()) {
+            return false;
+        }
+        for (int i = 0; i < command_moves.back(); i++) {
+            game.undo();
+        }
+        command_moves.pop_back();
+        return true;
+    }
+    
+    std::string final_score() const override {
+        ScoreEstimate estimate = estimate_final_score(game, config.komi, config.score_playouts);
+        double margin = estimate.black_score - estimate.white_score - config.komi;
+        if (margin == 0) {
+            return "0";
+        }
+        char text[32];
+        std::snprintf(text, sizeof(text), "%c+%g", margin > 0 ? 'B' : 'W', std::fabs(margin));
+        return text;
+    }
+    
+    std::string show() const override {
+        std::string header = "  ";
+        for (int x = 0; x < SIZE; x++) {
+            header += ' ';
+            header += COLUMNS[x];
+        }
+        std::ostringstream out;
+        out << '\n' << header << '\n';
+        const Board<SIZE>& board = game.get_board();
+        for (int y = 0; y < SIZE; y++) {
+            char row[4];
+            std::snprintf(row, sizeof(row), "%2d", SIZE - y);
+            out << row;
+            for (int x = 0; x < SIZE; x++) {
+                int color = board.get(x, y);
+                out << ' ' << (color == BLACK ? 'X' : color == WHITE ? 'O' : '.');
+            }
+            out << ' ' << row << '\n';
+        }
+        out << header;
+        return out.str();
+    }
+    
+    void start_ponder() override {
+        if (!config.ponder || game.is_game_over() || ponder_thread.joinable()) {
+            return;
+        }
+        // The search reads its own copy, so commands may change the game
+        // while it runs
+        ponder_game.reset(new Game<SIZE>(game));
+        search->set_limits(PONDER_SECONDS, 0);
+        ponder_thread = std::thread([this]() {
+            search->search(*ponder_game);
+        });
+    }
+    
+    void stop_ponder() override {
+        if (ponder_thread.joinable()) {
+            search->interrupt();
+            ponder_thread.join();
+            search->cancel_interrupt();
+        }
+    }
+};
+
+} // namespace
+
+GtpEngine::GtpEngine(const GtpConfig& config)
+    : config(config), main_time(0), byo_yomi_time(0), byo_yomi_stones(0), timed(false),
+      time_left{0, 0}, stones_left{0, 0}, quit(false) {
+    if (!config.book_path.empty()) {
+        book.reset(new OpeningBook());
+        if (!book->open(config.book_path)) {
+            book.reset();
+        }
+    }
+    int size = is_supported_board_size(config.board_size) ? config.board_size : DEFAULT_BOARD_SIZE;
+    session = dispatch_board_size(size, [&](auto board_size) {
+        return std::unique_ptr<GtpSession>(new SizedGtpSession<decltype(board_size)::value>(config, book.get()));
+    });
+}
+
+GtpEngine::~GtpEngine() = default;
+
+double GtpEngine::move_seconds(int color) const {
+    if (!timed) {
+        return config.seconds;
+    }
+    double left = time_left[color - 1];
+    int stones = stones_left[color - 1];
+    double seconds;
+    if (stones > 0) {
+        // Byo-yomi: an even share of the period
+        seconds = left / stones;
+    } else {
+        // Main time: spread over the moves still to come, at most half a
+        // board's worth, then lean on byo-yomi if there is one
+        int size = session->get_size();
+        double moves_left = std::max(15.0, (0.75 * size * size - session->get_move_number()) / 2);
+        seconds = left / moves_left;
+        if (byo_yomi_stones > 0) {
+            seconds = std::max(seconds, 0.8 * byo_yomi_time / byo_yomi_stones);
+        }
+    }
+    return std::max(0.05, seconds - TIME_MARGIN);
+}
+
+void GtpEngine::charge_time(int color, double seconds) {
+    // Keeps the clock when the controller sends no time_left; the next
+    // time_left overrides it
+    double& left = time_left[color - 1];
+    int& stones = stones_left[color - 1];
+    left -= seconds;
+    if (stones > 0) {
+        if (--stones == 0) {
+            left = byo_yomi_time;
+            stones = byo_yomi_stones;
+        }
+    } else if (left <= 0 && byo_yomi_stones > 0) {
+        left += byo_yomi_time;
+        stones = byo_yomi_stones;
+    }
+}
+
+std::string GtpEngine::run(const std::string& command, const std::string& arguments, bool& success) {
+    std::istringstream args(arguments);
+    success = false;
+    if (command == "protocol_version") {
+        success = true;
+        return "2";
+    }
+    if (command == "name") {
+        success = true;
+        return "GoGame";
+    }
+    if (command == "version") {
+        success = true;
+        return "1.0";
+    }
+    if (command == "known_command") {
+        std::string name;
+        args >> name;
+        success = true;
+        return contains(COMMANDS, std::size(COMMANDS), name) ? "true" : "false";
+    }
+    if (command == "list_commands") {
+        std::string list;
+        for (const char* name : COMMANDS) {
+            list += list.empty() ? "" : "\n";
+            list += name;
+        }
+        success = true;
+        return list;
+    }
+    if (command == "quit") {
+        quit = true;
+        success = true;
+        return "";
+    }
+    if (command == "boardsize") {
+        int size;
+        if (!(args >> size)) {
+            return "syntax error";
+        }
+        if (!is_supported_board_size(size)) {
+            return "unacceptable size";
+        }
+        GtpConfig sized = config;
+        sized.board_size = size;
+        session.reset();
+        session = dispatch_board_size(size, [&](auto board_size) {
+            return std::unique_ptr<GtpSession>(new SizedGtpSession<decltype(board_size)::value>(sized, book.get()));
+        });
+        config.board_size = size;
+        success = true;
+        return "";
+    }
+    if (command == "clear_board") {
+        session->clear();
+        success = true;
+        return "";
+    }
+    if (command == "komi") {
+        double komi;
+        if (!(args >> komi)) {
+            return "syntax error";
+        }
+        config.komi = komi;
+        session->set_komi(komi);
+        success = true;
+        return "";
+    }
+    if (command == "play") {
+        std::string color_name, vertex_name;
+        int color;
+        Position vertex;
+        if (!(args >> color_name >> vertex_name) || !parse_color(color_name, color) ||
+            !parse_vertex(vertex_name, session->get_size(), vertex)) {
+            return "syntax error";
+        }
+        if (!session->play(color, vertex)) {
+            return "illegal move";
+        }
+        success = true;
+        return "";
+    }
+    if (command == "genmove") {
+        std::string color_name;
+        int color;
+        if (!(args >> color_name) || !parse_color(color_name, color)) {
+            return "syntax error";
+        }
+        auto start = std::chrono::steady_clock::now();
+        Position move;
+        bool played = session->generate(color, move_seconds(color), move);
+        if (timed) {
+            charge_time(color, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        success = true;
+        return played ? format_vertex(move, session->get_size()) : "resign";
+    }
+    if (command == "undo") {
+        if (!session->undo()) {
+            return "cannot undo";
+        }
+        success = true;
+        return "";
+    }
+    if (command == "final_score") {
+        success = true;
+        return session->final_score();
+    }
+    if (command == "time_settings") {
+        int stones;
+        if (!(args >> main_time >> byo_yomi_time >> stones)) {
+            return "syntax error";
+        }
+        byo_yomi_stones = stones;
+        // Byo-yomi time without stones means no time limit
+        timed = !(byo_yomi_time > 0 && stones == 0);
+        time_left[0] = time_left[1] = main_time;
+        stones_left[0] = stones_left[1] = 0;
+        success = true;
+        return "";
+    }
+    if (command == "time_left") {
+        std::string color_name;
+        int color;
+        double seconds;
+        int stones;
+        if (!(args >> color_name >> seconds >> stones) || !parse_color(color_name, color)) {
+            return "syntax error";
+        }
+        time_left[color - 1] = seconds;
+        stones_left[color - 1] = stones;
+        success = true;
+        return "";
+    }
+    if (command == "showboard") {
+        success = true;
+        return session->show();
+    }
+    return "unknown command";
+}
+
+std::string GtpEngine::execute(const std::string& line) {
+    // Drop control characters and comments, and read tabs as spaces
+    std::string text;
+    for (char c : line) {
+        if (c == '#') {
+            break;
+        }
+        if (c == '\t') {
+            text += ' ';
+        } else if ((unsigned char)c >= 32 && c != 127) {
+            text += c;
+        }
+    }
+    std::istringstream in(text);
+    std::string id, command;
+    if (!(in >> command)) {
+        return "";
+    }
+    if (std::isdigit((unsigned char)command[0])) {
+        id = command;
+        // An id with no command still gets its one response
+        if (!(in >> command)) {
+            return "?" + id + " syntax error\n\n";
+        }
+    }
+    std::string arguments;
+    std::getline(in, arguments);
+    
+    bool passive = contains(PASSIVE_COMMANDS, std::size(PASSIVE_COMMANDS), command);
+    if (!passive) {
+        session->stop_ponder();
+    }
+    bool success;
+    std::string response = run(command, arguments, success);
+    if (!quit) {
+        session->start_ponder();
+    }
+    
+    std::string prefix = (success ? "=" : "?") + id;
+    return prefix + (response.empty() || response[0] == '\n' ? "" : " ") + response + "\n\n";
+}
+
+bool GtpEngine::has_quit() const {
+    return quit;
+}
+
+bool GtpEngine::has_book() const {
+    return config.book_path.empty() || book != nullptr;
+}
@@ -0,0 +1,66 @@
+#ifndef GTP_H
+#define GTP_H
+
+#include "board.h"
+#include <memory>
+#include <string>
+
+struct GtpConfig {
+    int board_size = DEFAULT_BOARD_SIZE;
+    double komi = 7.5;
+    int threads = 0;               // search threads, 0 uses every hardware thread
+    double seconds = 5.0;          // per move until time_settings gives a clock
+    long long playouts = 0;        // per move cap, 0 for none
+    bool ponder = true;            // search on the opponent's time
+    double resign_win_rate = 0.0;  // genmove resigns below this win rate, 0 never
+    int score_playouts = 256;      // playouts behind final_score
+    std::string book_path;         // opening book for genmove, empty for none
+};
+
+class GtpSession;
+class OpeningBook;
+
+// Go Text Protocol (version 2) front-end over Game and MctsSearch. One
+// command line in, one complete response out, so the caller's loop only
+// reads and writes.
+//
+// After each command that leaves the opponent to move, a ponder search
+// runs on a worker thread from the current position. The next command
+// interrupts it, which costs at most one playout per search thread, and
+// genmove then reuses the subtree it grew for the move that was played.
+// Commands that only report (name, list_commands, time_left, ...) are
+// answered without stopping it.
+//
+// With an opening book, genmove plays the book's most played move while
+// the position is in it and searches only once play leaves the book.
+class GtpEngine {
+private:
+    GtpConfig config;
+    std::unique_ptr<OpeningBook> book;  // null without one; outlives session
+    std::unique_ptr<GtpSession> session;
+    double main_time;
+    double byo_yomi_time;
+    int byo_yomi_stones;
+    bool timed;                    // time_settings gave a clock
+    double time_left[2];           // as of the last time_left, by color
+    int stones_left[2];            // 0 while still in main time
+    bool quit;
+    
+    double move_seconds(int color) const;
+    void charge_time(int color, double seconds);
+    std::string run(const std::string& command, const std::string& arguments, bool& success);
+
+public:
+    explicit GtpEngine(const GtpConfig& config);
+    ~GtpEngine();
+    
+    // Executes one command line and returns its response, ending in the
+    // blank line GTP requires; empty for blank and comment lines
+    std::string execute(const std::string& line);
+    // True once quit has been executed
+    bool has_quit() const;
+    // False if config named a book that could not be opened
+    bool has_book() const;
+};
+
+#endif // GTP_H
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <string>
+#include "gtp.h"
+
+namespace {
+
+struct Exchange {
+    const char* command;
+    const char* response;   // expected, without the closing blank line; null for any but "= pass"
+};
+
+// Command sequences with the responses a controller relies on. GTP lets
+// either color move at any time, so most of them play out of turn.
+const Exchange SCRIPT[] = {
+    {"boardsize 9", "="},
+    
+    // One color twice in a row, then a pass: the skipped turn in front of
+    // c3 must not count as Black's pass and end the game
+    {"clear_board", "="},
+    {"play b d4", "="},
+    {"play b e5", "="},
+    {"play w pass", "="},
+    {"play w c3", "="},
+    {"play b c3", "? illegal move"},
+    {"undo", "="},
+    {"play w c3", "="},
+    {"play b d5", "="},
+    
+    // The same for genmove after the opponent passed
+    {"clear_board", "="},
+    {"play b d4", "="},
+    {"play w pass", "="},
+    {"genmove w", nullptr},
+    
+    // Ids come back on the response, and a line holding only an id still
+    // gets one
+    {"5", "?5 syntax error"},
+    {"6 play b a1", "=6"},
+    
+    // Two real passes still end the game
+    {"clear_board", "="},
+    {"play b pass", "="},
+    {"play w pass", "="},
+    {"play b d4", "? illegal move"},
+};
+
+} // namespace
+
+// Runs SCRIPT through GtpEngine and exits nonzero at the first response
+// that differs. Searches are capped at a few hundred playouts on one
+// thread without pondering, so the run is quick and repeatable. CTest
+// runs it.
+int main() {
+    GtpConfig config;
+    config.threads = 1;
+    config.seconds = 0;
+    config.playouts = 200;
+    config.ponder = false;
+    GtpEngine engine(config);
+    for (const Exchange& exchange : SCRIPT) {
+        std::string response = engine.execute(exchange.command);
+        if (response.size() < 2 || response.compare(response.size() - 2, 2, "\n\n") != 0) {
+            std::cerr << exchange.command << ": response does not end in a blank line" << std::endl;
+            return 1;
+        }
+        response.resize(response.size() - 2);
+        bool expected = exchange.response ? response == exchange.response
+                                          : response[0] == '=' && response != "= pass";
+        if (!expected) {
+            std::cerr << exchange.command << ": got \"" << response << "\", expected \""
+                      << (exchange.response ? exchange.response : "= <move>") << "\"" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << std::size(SCRIPT) << " GTP responses as expected" << std::endl;
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include "gtp.h"
+
+namespace {
+
+void print_usage() {
+    std::cerr << "Usage: GoGtp [--size 9|13|19] [--komi K] [--threads N] [--seconds S]\n"
+                 "             [--playouts N] [--resign WIN_RATE] [--book BOOK.gob] [--no-ponder]" << std::endl;
+}
+
+} // namespace
+
+// Go Text Protocol engine on stdin and stdout, for GUIs and match
+// controllers such as GoGui or Sabaki. --seconds is the time per move
+// until the controller sends time_settings; --book answers opening moves
+// from a book written by GoCorpus book.
+int main(int argc, char** argv) {
+    GtpConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--no-ponder") {
+            config.ponder = false;
+            continue;
+        }
+        if (!value) {
+            print_usage();
+            return 1;
+        }
+        i++;
+        if (arg == "--size") {
+            config.board_size = std::atoi(value);
+        } else if (arg == "--komi") {
+            config.komi = std::atof(value);
+        } else if (arg == "--threads") {
+            config.threads = std::atoi(value);
+        } else if (arg == "--seconds") {
+            config.seconds = std::atof(value);
+        } else if (arg == "--playouts") {
+            config.playouts = std::atoll(value);
+        } else if (arg == "--resign") {
+            config.resign_win_rate = std::atof(value);
+        } else if (arg == "--book") {
+            config.book_path = value;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (config.threads < 0 || config.seconds < 0 || config.playouts < 0 ||
+        !is_supported_board_size(config.board_size)) {
+        print_usage();
+        return 1;
+    }
+    
+    // Responses are flushed one by one: the controller waits for each
+    std::ios::sync_with_stdio(false);
+    GtpEngine engine(config);
+    if (!engine.has_book()) {
+        std::cerr << "Cannot open book " << config.book_path << std::endl;
+        return 1;
+    }
+    std::string line;
+    while (!engine.has_quit() && std::getline(std::cin, line)) {
+        std::string response = engine.execute(line);
+        if (!response.empty()) {
+            std::cout << response << std::flush;
+        }
+    }
+    return 0;
+}
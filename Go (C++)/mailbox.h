@@ -0,0 +1,52 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Neither side ever waits: post() fails when the queue is
+// full and take() when it is empty, so a render loop can poll it every
+// frame. Each index is written by one side only and published with a
+// release store that the other side reads with an acquire load.
+template <typename T, size_t CAPACITY>
+class Mailbox {
+private:
+    static_assert(CAPACITY > 0, "a mailbox holds at least one message");
+    
+    T slots[CAPACITY + 1];              // one slot stays free to tell full from empty
+    std::atomic<size_t> head;           // next slot to take, written by the consumer
+    std::atomic<size_t> tail;           // next slot to post to, written by the producer
+
+public:
+    Mailbox() : head(0), tail(0) {}
+    
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+    
+    // Producer side; false when the queue is full
+    bool post(T message) {
+        size_t at = tail.load(std::memory_order_relaxed);
+        size_t next = at == CAPACITY ? 0 : at + 1;
+        if (next == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[at] = std::move(message);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side; false when the queue is empty
+    bool take(T& message) {
+        size_t at = head.load(std::memory_order_relaxed);
+        if (at == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        message = std::move(slots[at]);
+        head.store(at == CAPACITY ? 0 : at + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif // MAILBOX_H
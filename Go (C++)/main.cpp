@@ -1,15 +1,24 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <thread>
+#include <tuple>
+#include <variant>
 #include "game.h"
+#include "mailbox.h"
+#include "mcts.h"
+#include "ownership.h"
 
 constexpr int WINDOW_WIDTH = 1400;
 constexpr int WINDOW_HEIGHT = 1600;
 constexpr int BOARD_PADDING = 50;
-constexpr int CELL_SIZE = 50;
-constexpr int STONE_RADIUS = 22;
-constexpr int BOARD_SIZE_PIXELS = BOARD_PADDING * 2 + (BOARD_SIZE - 1) * CELL_SIZE;
+constexpr int BOARD_SIZE_PIXELS = 1000;
+constexpr int GRID_PIXELS = BOARD_SIZE_PIXELS - BOARD_PADDING * 2;
 constexpr int BOARD_OFFSET_X = (WINDOW_WIDTH - BOARD_SIZE_PIXELS) / 2;
 constexpr int BOARD_OFFSET_Y = 180;
 
@@ -18,17 +27,279 @@ sf::Color LINE_COLOR(0, 0, 0);
 sf::Color BLACK_STONE(0, 0, 0);
 sf::Color WHITE_STONE(255, 255, 255);
 sf::Color BACKGROUND(255, 255, 255);
+sf::Color STONE_OUTLINE(51, 51, 51);
+
+// Board outline width, drawn in a margin around the cached board layer
+constexpr int BOARD_OUTLINE = 2;
+
+// Triangles per stone disc in the stone vertex array; each stone is an
+// outline disc under a filled one
+constexpr int STONE_SEGMENTS = 32;
+constexpr int STONE_VERTICES = 2 * STONE_SEGMENTS * 3;
+
+// Board size buttons, left to right after Pass
+constexpr int SIZE_BUTTON_X = 650;
+constexpr int SIZE_BUTTON_WIDTH = 140;
+constexpr int SIZE_BUTTON_GAP = 20;
+
+// Engine button, right of the size buttons
+constexpr int ENGINE_BUTTON_X = 1130;
+constexpr int ENGINE_BUTTON_WIDTH = 240;
+
+// Thinking time per engine move
+constexpr double ENGINE_SECONDS = 2.0;
+
+// What the engine thread sends back when its search ends
+struct EngineReply {
+    uint64_t job;
+    Position move;
+};
+
+// Ownership button, under the board
+constexpr int ANALYSIS_BUTTON_X = 30;
+constexpr int ANALYSIS_BUTTON_Y = 1220;
+constexpr int ANALYSIS_BUTTON_WIDTH = 240;
+
+// Playouts behind each ownership overlay. The game-over score counts no
+// komi, so neither does the estimate.
+constexpr int ANALYSIS_PLAYOUTS = 2000;
+constexpr double ANALYSIS_KOMI = 0.0;
+
+struct AnalysisReply {
+    uint64_t job;
+    int size;
+    OwnershipAnalysis analysis;
+};
+
+struct Button {
+    sf::RectangleShape shape;
+    sf::Text label;
+};
 
 class GoGame {
 private:
-    Game game;
+    // One game of the selected size; every size is its own instantiation
+    std::variant<Game<9>, Game<13>, Game<19>> game;
+    int boardSize;
+    int cellSize;
+    int stoneRadius;
     sf::Font font;
     sf::Text currentPlayerText;
     sf::Text statusText;
     sf::Text scoreText;
+    sf::Text engineText;
     std::string statusMessage;
     sf::Color statusColor;
     
+    // Retained scene: the static board layer, one vertex array for all the
+    // stones and the buttons, each rebuilt only when what it shows changes
+    sf::RenderTexture boardLayer;
+    sf::Sprite boardSprite;
+    sf::VertexArray stoneVertices;  // a fixed slot of STONE_VERTICES per point
+    BoardEventLog boardEvents;      // board changes not yet applied to stoneVertices
+    Button newGameButton;
+    Button undoButton;
+    Button passButton;
+    Button sizeButtons[3];
+    Button engineButton;
+    
+    // Human-vs-engine mode: the engine plays engineColor, EMPTY when off.
+    // It searches on a worker thread against a copy of the game and posts
+    // its move to engineReplies, which render() polls once a frame, so
+    // neither the event loop nor the drawing ever waits for it.
+    int engineColor;
+    std::tuple<std::unique_ptr<MctsSearch<9>>, std::unique_ptr<MctsSearch<13>>,
+               std::unique_ptr<MctsSearch<19>>> searches;  // created on first use, trees kept between moves
+    std::thread engineThread;
+    Mailbox<EngineReply, 2> engineReplies;
+    bool engineRunning;        // engineThread has not been joined yet
+    int engineSize;            // board size of the running search
+    uint64_t engineJob;        // replies from older jobs were cancelled
+    std::chrono::steady_clock::time_point engineStart;
+    
+    // Ownership overlay and score estimate, recomputed on a worker thread
+    // after every change to the game and shown once they arrive
+    bool showOwnership;
+    std::thread analysisThread;
+    Mailbox<AnalysisReply, 2> analysisReplies;
+    bool analysisRunning;
+    uint64_t analysisJob;      // bumped by every change to the game
+    uint64_t analysisShown;    // job of the overlay on screen
+    sf::VertexArray ownershipVertices;
+    sf::Text analysisText;
+    Button analysisButton;
+    
+    template <typename F>
+    decltype(auto) withGame(F&& f) {
+        return std::visit(std::forward<F>(f), game);
+    }
+    
+    template <typename F>
+    decltype(auto) withGame(F&& f) const {
+        return std::visit(std::forward<F>(f), game);
+    }
+    
+    void newGame(int size) {
+        cancelEngine();
+        dispatch_board_size(size, [&](auto board_size) {
+            game.emplace<Game<decltype(board_size)::value>>();
+        });
+        boardSize = size;
+        cellSize = GRID_PIXELS / (size - 1);
+        stoneRadius = cellSize * 22 / 50;
+        buildBoardLayer();
+        resetStones();
+        // The overlay of the old board does not fit the new one
+        analysisShown = 0;
+        updateUI();
+        startEngine();
+    }
+    
+    template <int SIZE>
+    MctsSearch<SIZE>& getSearch() {
+        auto& search = std::get<std::unique_ptr<MctsSearch<SIZE>>>(searches);
+        if (!search) {
+            // One core is left to the window
+            SearchConfig config;
+            config.threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+            config.seconds = ENGINE_SECONDS;
+            search.reset(new MctsSearch<SIZE>(config));
+        }
+        return *search;
+    }
+    
+    template <typename F>
+    decltype(auto) withEngineSearch(F&& f) {
+        return dispatch_board_size(engineSize, [&](auto board_size) {
+            return f(getSearch<decltype(board_size)::value>());
+        });
+    }
+    
+    template <int SIZE>
+    void launchEngine(const Game<SIZE>& g) {
+        MctsSearch<SIZE>* search = &getSearch<SIZE>();
+        uint64_t job = engineJob;
+        engineSize = SIZE;
+        engineThread = std::thread([this, search, job, snapshot = g]() {
+            SearchResult result = search->search(snapshot);
+            engineReplies.post(EngineReply{job, result.best_move});
+        });
+    }
+    
+    // Starts the engine when it is its turn and no search is in flight. A
+    // cancelled search still finishing delays this until its reply is in.
+    void startEngine() {
+        if (engineColor == EMPTY || engineRunning || isGameOver() ||
+            withGame([](const auto& g) { return g.get_current_player(); }) != engineColor) {
+            return;
+        }
+        engineRunning = true;
+        engineStart = std::chrono::steady_clock::now();
+        withGame([&](const auto& g) { launchEngine(g); });
+    }
+    
+    // Drops the move being computed. The search stops within a playout and
+    // its reply is thrown away when it arrives.
+    void cancelEngine() {
+        engineJob++;
+        if (engineRunning) {
+            withEngineSearch([](auto& search) { search.interrupt(); });
+        }
+    }
+    
+    // Plays the engine's move once its reply is in; never waits for it
+    void pollEngine() {
+        EngineReply reply;
+        if (!engineReplies.take(reply)) {
+            return;
+        }
+        // The reply is the thread's last act, so this join is immediate
+        engineThread.join();
+        engineRunning = false;
+        withEngineSearch([](auto& search) { search.cancel_interrupt(); });
+        if (reply.job == engineJob && !isGameOver()) {
+            withGame([&](auto& g) {
+                if (!g.make_move(reply.move.x, reply.move.y)) {
+                    g.make_move(-1, -1);
+                }
+            });
+            updateUI();
+        }
+        startEngine();
+    }
+    
+    template <int SIZE>
+    void launchAnalysis(const Game<SIZE>& g) {
+        int threads = std::max(1, (int)std::thread::hardware_concurrency() / 2);
+        uint64_t job = analysisJob;
+        analysisThread = std::thread([this, threads, job, snapshot = g]() {
+            OwnershipAnalysis analysis = analyze_ownership(snapshot, ANALYSIS_KOMI, ANALYSIS_PLAYOUTS, threads);
+            analysisReplies.post(AnalysisReply{job, SIZE, std::move(analysis)});
+        });
+    }
+    
+    // Analyzes the current position unless that is already done or under
+    // way. An analysis of an older position runs to the end first; it is
+    // short and cannot be interrupted.
+    void startAnalysis() {
+        if (!showOwnership || analysisRunning || analysisShown == analysisJob) {
+            return;
+        }
+        analysisRunning = true;
+        withGame([&](const auto& g) { launchAnalysis(g); });
+    }
+    
+    void pollAnalysis() {
+        AnalysisReply reply;
+        if (!analysisReplies.take(reply)) {
+            return;
+        }
+        analysisThread.join();
+        analysisRunning = false;
+        // An overlay one move old is still shown until the next one is in
+        if (reply.size == boardSize) {
+            analysisShown = reply.job;
+            buildOwnership(reply.analysis);
+        }
+        startAnalysis();
+    }
+    
+    // One square per point, black or white, as opaque as the point is sure
+    void buildOwnership(const OwnershipAnalysis& analysis) {
+        ownershipVertices.clear();
+        float half = cellSize * 0.2f;
+        for (int y = 0; y < boardSize; y++) {
+            for (int x = 0; x < boardSize; x++) {
+                float owner = analysis.ownership[y * boardSize + x];
+                sf::Color color = owner > 0 ? sf::Color(0, 0, 0) : sf::Color(255, 255, 255);
+                color.a = (sf::Uint8)(std::min(1.0f, std::fabs(owner)) * 220);
+                float centerX = BOARD_OFFSET_X + BOARD_PADDING + x * cellSize;
+                float centerY = BOARD_OFFSET_Y + BOARD_PADDING + y * cellSize;
+                sf::Vector2f corners[4] = {
+                    sf::Vector2f(centerX - half, centerY - half), sf::Vector2f(centerX + half, centerY - half),
+                    sf::Vector2f(centerX + half, centerY + half), sf::Vector2f(centerX - half, centerY + half)
+                };
+                for (int corner : {0, 1, 2, 0, 2, 3}) {
+                    ownershipVertices.append(sf::Vertex(corners[corner], color));
+                }
+            }
+        }
+        
+        double margin = analysis.expected_score;
+        std::ostringstream text;
+        text.setf(std::ios::fixed);
+        text.precision(1);
+        text << "Estimate: " << (margin >= 0 ? "B+" : "W+") << std::fabs(margin) << " +- "
+             << std::sqrt(analysis.score_variance) << " (Black wins " << (int)(analysis.black_win_rate * 100 + 0.5)
+             << "%)";
+        analysisText.setString(text.str());
+    }
+    
+    bool isEngineTurn() const {
+        return engineColor != EMPTY &&
+               withGame([](const auto& g) { return g.get_current_player(); }) == engineColor;
+    }
+    
     bool loadFont() {
         // Try to load a system font or use default
         if (!font.loadFromFile("C:/Windows/Fonts/arial.ttf")) {
@@ -56,18 +327,34 @@ private:
             scoreText.setCharacterSize(28);
             scoreText.setFillColor(sf::Color::Black);
             scoreText.setPosition(30, 1500);
+            
+            engineText.setFont(font);
+            engineText.setCharacterSize(28);
+            engineText.setFillColor(sf::Color(80, 80, 80));
+            engineText.setPosition(650, 38);
+            
+            analysisText.setFont(font);
+            analysisText.setCharacterSize(28);
+            analysisText.setFillColor(sf::Color::Black);
+            analysisText.setPosition(ANALYSIS_BUTTON_X + ANALYSIS_BUTTON_WIDTH + 30, ANALYSIS_BUTTON_Y + 8);
+            
+            setupButtons();
         }
         updateUI();
     }
     
     void updateUI() {
-        std::string playerName = (game.get_current_player() == BLACK) ? "Black" : "White";
+        analysisJob++;
+        startAnalysis();
+        
+        int currentPlayer = withGame([](const auto& g) { return g.get_current_player(); });
+        std::string playerName = (currentPlayer == BLACK) ? "Black" : "White";
         if (font.getInfo().family != "") {
             currentPlayerText.setString("Current Player: " + playerName);
         }
         
-        if (game.is_game_over()) {
-            auto scores = game.calculate_score();
+        if (isGameOver()) {
+            auto scores = withGame([](const auto& g) { return g.calculate_score(); });
             int blackScore = scores.first;
             int whiteScore = scores.second;
             std::string winner;
@@ -93,154 +380,220 @@ private:
             statusText.setString(statusMessage);
             statusText.setFillColor(statusColor);
         }
+        updateButtons();
     }
     
     sf::Vector2i getBoardCoords(int mouseX, int mouseY) const {
         int x = mouseX - BOARD_OFFSET_X;
         int y = mouseY - BOARD_OFFSET_Y;
         
-        int boardX = std::round((float)(x - BOARD_PADDING) / CELL_SIZE);
-        int boardY = std::round((float)(y - BOARD_PADDING) / CELL_SIZE);
+        int boardX = std::round((float)(x - BOARD_PADDING) / cellSize);
+        int boardY = std::round((float)(y - BOARD_PADDING) / cellSize);
         
-        if (boardX >= 0 && boardX < BOARD_SIZE && boardY >= 0 && boardY < BOARD_SIZE) {
+        if (boardX >= 0 && boardX < boardSize && boardY >= 0 && boardY < boardSize) {
             return sf::Vector2i(boardX, boardY);
         }
         return sf::Vector2i(-1, -1);
     }
     
-    void drawBoard(sf::RenderWindow& window) {
-        // Draw board background
+    // Draws the board, grid and star points into boardLayer. They only
+    // change with the board size, so each frame just copies the layer.
+    void buildBoardLayer() {
+        boardLayer.clear(sf::Color::Transparent);
+        
+        // Board background; the outline lies inside the layer's margin
         sf::RectangleShape boardBg(sf::Vector2f(BOARD_SIZE_PIXELS, BOARD_SIZE_PIXELS));
-        boardBg.setPosition(BOARD_OFFSET_X, BOARD_OFFSET_Y);
+        boardBg.setPosition(BOARD_OUTLINE, BOARD_OUTLINE);
         boardBg.setFillColor(BOARD_COLOR);
         boardBg.setOutlineColor(sf::Color(139, 105, 20));
-        boardBg.setOutlineThickness(2);
-        window.draw(boardBg);
+        boardBg.setOutlineThickness(BOARD_OUTLINE);
+        boardLayer.draw(boardBg);
         
-        // Draw grid lines
-        sf::RectangleShape line(sf::Vector2f(1, (BOARD_SIZE - 1) * CELL_SIZE));
+        // Grid lines
+        int gridLength = (boardSize - 1) * cellSize;
+        int origin = BOARD_OUTLINE + BOARD_PADDING;
+        sf::RectangleShape line(sf::Vector2f(1, gridLength));
         line.setFillColor(LINE_COLOR);
         
-        for (int i = 0; i < BOARD_SIZE; i++) {
-            int pos = BOARD_PADDING + i * CELL_SIZE;
+        for (int i = 0; i < boardSize; i++) {
+            int pos = origin + i * cellSize;
             
             // Vertical lines
-            line.setSize(sf::Vector2f(1, (BOARD_SIZE - 1) * CELL_SIZE));
-            line.setPosition(BOARD_OFFSET_X + pos, BOARD_OFFSET_Y + BOARD_PADDING);
-            window.draw(line);
+            line.setSize(sf::Vector2f(1, gridLength));
+            line.setPosition(pos, origin);
+            boardLayer.draw(line);
             
             // Horizontal lines
-            line.setSize(sf::Vector2f((BOARD_SIZE - 1) * CELL_SIZE, 1));
-            line.setPosition(BOARD_OFFSET_X + BOARD_PADDING, BOARD_OFFSET_Y + pos);
-            window.draw(line);
+            line.setSize(sf::Vector2f(gridLength, 1));
+            line.setPosition(origin, pos);
+            boardLayer.draw(line);
         }
         
-        // Draw star points (hoshi)
-        const int starPoints[] = {3, 9, 15};
+        // Star points (hoshi): on the third line from the edge on 9x9,
+        // the fourth on larger boards, plus the sides and the center
+        int edge = boardSize < 13 ? 2 : 3;
+        const int starPoints[] = {edge, boardSize / 2, boardSize - 1 - edge};
         sf::CircleShape star(5);
         star.setFillColor(LINE_COLOR);
         for (int x : starPoints) {
             for (int y : starPoints) {
-                star.setPosition(
-                    BOARD_OFFSET_X + BOARD_PADDING + x * CELL_SIZE - 5,
-                    BOARD_OFFSET_Y + BOARD_PADDING + y * CELL_SIZE - 5
-                );
-                window.draw(star);
+                star.setPosition(origin + x * cellSize - 5, origin + y * cellSize - 5);
+                boardLayer.draw(star);
             }
         }
         
-        // Draw stones
-        auto boardState = game.get_board_state();
-        for (int y = 0; y < BOARD_SIZE; y++) {
-            for (int x = 0; x < BOARD_SIZE; x++) {
-                int color = boardState[y][x];
-                if (color != EMPTY) {
-                    drawStone(window, x, y, color);
+        boardLayer.display();
+        boardSprite.setTexture(boardLayer.getTexture(), true);
+        boardSprite.setPosition(BOARD_OFFSET_X - BOARD_OUTLINE, BOARD_OFFSET_Y - BOARD_OUTLINE);
+    }
+    
+    // Writes a filled circle as a fan of triangles to the vertices from
+    // vertex on
+    void writeDisc(sf::Vertex* vertex, float centerX, float centerY, float radius, sf::Color color) {
+        constexpr float STEP = 6.28318531f / STONE_SEGMENTS;
+        sf::Vector2f center(centerX, centerY);
+        sf::Vector2f previous(centerX + radius, centerY);
+        for (int i = 1; i <= STONE_SEGMENTS; i++) {
+            sf::Vector2f next(centerX + radius * std::cos(i * STEP), centerY + radius * std::sin(i * STEP));
+            *vertex++ = sf::Vertex(center, color);
+            *vertex++ = sf::Vertex(previous, color);
+            *vertex++ = sf::Vertex(next, color);
+            previous = next;
+        }
+    }
+    
+    // Draws the stone of color at (x, y) into its slot; EMPTY makes the
+    // slot transparent
+    void setStone(int x, int y, int color) {
+        sf::Vertex* slot = &stoneVertices[(y * boardSize + x) * STONE_VERTICES];
+        float centerX = BOARD_OFFSET_X + BOARD_PADDING + x * cellSize;
+        float centerY = BOARD_OFFSET_Y + BOARD_PADDING + y * cellSize;
+        sf::Color fill = color == BLACK ? BLACK_STONE : WHITE_STONE;
+        bool empty = color == EMPTY;
+        writeDisc(slot, centerX, centerY, stoneRadius + 1, empty ? sf::Color::Transparent : STONE_OUTLINE);
+        writeDisc(slot + STONE_VERTICES / 2, centerX, centerY, stoneRadius, empty ? sf::Color::Transparent : fill);
+    }
+    
+    // Sizes stoneVertices for the board and fills it from the game, which
+    // from now on reports its changes to boardEvents
+    void resetStones() {
+        stoneVertices.resize(boardSize * boardSize * STONE_VERTICES);
+        boardEvents.events.clear();
+        withGame([&](auto& g) {
+            g.set_event_log(&boardEvents);
+            for (int y = 0; y < boardSize; y++) {
+                for (int x = 0; x < boardSize; x++) {
+                    setStone(x, y, g.get_board().get(x, y));
+                }
+            }
+        });
+    }
+    
+    // Applies the board changes since the last frame, touching only the
+    // slots of the points that changed
+    void updateStones() {
+        for (const BoardEvent& event : boardEvents.events) {
+            if (event.kind == BoardEvent::StonePlaced) {
+                setStone(event.x, event.y, event.color);
+            } else if (event.kind == BoardEvent::StoneRemoved) {
+                setStone(event.x, event.y, EMPTY);
+            } else if (event.kind == BoardEvent::Cleared) {
+                for (int y = 0; y < boardSize; y++) {
+                    for (int x = 0; x < boardSize; x++) {
+                        setStone(x, y, EMPTY);
+                    }
                 }
             }
         }
+        boardEvents.events.clear();
     }
     
-    void drawStone(sf::RenderWindow& window, int x, int y, int color) {
-        float centerX = BOARD_OFFSET_X + BOARD_PADDING + x * CELL_SIZE;
-        float centerY = BOARD_OFFSET_Y + BOARD_PADDING + y * CELL_SIZE;
-        
-        sf::CircleShape stone(STONE_RADIUS);
-        stone.setPosition(centerX - STONE_RADIUS, centerY - STONE_RADIUS);
-        
-        if (color == BLACK) {
-            stone.setFillColor(BLACK_STONE);
-            stone.setOutlineColor(sf::Color(51, 51, 51));
-        } else {
-            stone.setFillColor(WHITE_STONE);
-            stone.setOutlineColor(sf::Color(51, 51, 51));
+    void drawBoard(sf::RenderWindow& window) {
+        updateStones();
+        window.draw(boardSprite);
+        window.draw(stoneVertices);
+        if (showOwnership && analysisShown != 0) {
+            window.draw(ownershipVertices);
         }
-        stone.setOutlineThickness(1);
-        window.draw(stone);
+    }
+    
+    void setupButton(Button& button, int x, int width, const std::string& label, int labelX) {
+        button.shape.setSize(sf::Vector2f(width, 50));
+        button.shape.setPosition(x, 120);
+        button.shape.setOutlineColor(sf::Color::Black);
+        button.shape.setOutlineThickness(3);
+        button.label.setFont(font);
+        button.label.setCharacterSize(24);
+        button.label.setString(label);
+        button.label.setPosition(labelX, 130);
+    }
+    
+    // A shaded button is selected or, with a gray label, disabled
+    void setButtonState(Button& button, bool shaded, bool enabled) {
+        button.shape.setFillColor(shaded ? sf::Color(200, 200, 200) : BACKGROUND);
+        button.label.setFillColor(enabled ? sf::Color::Black : sf::Color(128, 128, 128));
+    }
+    
+    void setupButtons() {
+        setupButton(newGameButton, 30, 180, "New Game", 50);
+        setupButton(undoButton, 230, 180, "Undo", 280);
+        setupButton(passButton, 430, 180, "Pass", 480);
+        for (int i = 0; i < 3; i++) {
+            int size = BOARD_SIZES[i];
+            int x = SIZE_BUTTON_X + i * (SIZE_BUTTON_WIDTH + SIZE_BUTTON_GAP);
+            setupButton(sizeButtons[i], x, SIZE_BUTTON_WIDTH, std::to_string(size) + "x" + std::to_string(size), x + 30);
+        }
+        setupButton(engineButton, ENGINE_BUTTON_X, ENGINE_BUTTON_WIDTH, "", ENGINE_BUTTON_X + 30);
+        setupButton(analysisButton, ANALYSIS_BUTTON_X, ANALYSIS_BUTTON_WIDTH, "", ANALYSIS_BUTTON_X + 30);
+        analysisButton.shape.setPosition(ANALYSIS_BUTTON_X, ANALYSIS_BUTTON_Y);
+        analysisButton.label.setPosition(ANALYSIS_BUTTON_X + 30, ANALYSIS_BUTTON_Y + 10);
+    }
+    
+    // Brings the buttons in line with the game; called on every change
+    // rather than every frame
+    void updateButtons() {
+        // Once the game is over Undo and Pass stay drawn, shaded with gray
+        // labels, as the per-frame drawing always showed them
+        bool over = isGameOver();
+        setButtonState(newGameButton, false, true);
+        setButtonState(undoButton, over, !over);
+        setButtonState(passButton, over, !over);
+        for (int i = 0; i < 3; i++) {
+            setButtonState(sizeButtons[i], BOARD_SIZES[i] == boardSize, true);
+        }
+        setButtonState(engineButton, engineColor != EMPTY, true);
+        setButtonState(analysisButton, showOwnership, true);
+        analysisButton.label.setString(showOwnership ? "Ownership: On" : "Ownership: Off");
+        engineButton.label.setString(engineColor == BLACK ? "Engine: Black" :
+                                     engineColor == WHITE ? "Engine: White" : "Engine: Off");
     }
     
     void drawButtons(sf::RenderWindow& window) {
-        // Draw button backgrounds and text
         if (font.getInfo().family == "") return;
         
-        // New Game button
-        sf::RectangleShape newGameBtn(sf::Vector2f(180, 50));
-        newGameBtn.setPosition(30, 120);
-        newGameBtn.setFillColor(BACKGROUND);
-        newGameBtn.setOutlineColor(sf::Color::Black);
-        newGameBtn.setOutlineThickness(3);
-        window.draw(newGameBtn);
-        
-        sf::Text newGameText("New Game", font, 24);
-        newGameText.setFillColor(sf::Color::Black);
-        newGameText.setPosition(50, 130);
-        window.draw(newGameText);
-        
-        // Undo button
-        sf::RectangleShape undoBtn(sf::Vector2f(180, 50));
-        undoBtn.setPosition(230, 120);
-        undoBtn.setFillColor(BACKGROUND);
-        undoBtn.setOutlineColor(sf::Color::Black);
-        undoBtn.setOutlineThickness(3);
-        if (!game.is_game_over()) {
-            window.draw(undoBtn);
-            
-            sf::Text undoText("Undo", font, 24);
-            undoText.setFillColor(sf::Color::Black);
-            undoText.setPosition(280, 130);
-            window.draw(undoText);
-        } else {
-            undoBtn.setFillColor(sf::Color(200, 200, 200));
-            window.draw(undoBtn);
-            
-            sf::Text undoText("Undo", font, 24);
-            undoText.setFillColor(sf::Color(128, 128, 128));
-            undoText.setPosition(280, 130);
-            window.draw(undoText);
+        const Button* buttons[] = {&newGameButton, &undoButton, &passButton, &sizeButtons[0],
+                                   &sizeButtons[1], &sizeButtons[2], &engineButton, &analysisButton};
+        for (const Button* button : buttons) {
+            window.draw(button->shape);
+            window.draw(button->label);
         }
-        
-        // Pass button
-        sf::RectangleShape passBtn(sf::Vector2f(180, 50));
-        passBtn.setPosition(430, 120);
-        passBtn.setFillColor(BACKGROUND);
-        passBtn.setOutlineColor(sf::Color::Black);
-        passBtn.setOutlineThickness(3);
-        if (!game.is_game_over()) {
-            window.draw(passBtn);
-            
-            sf::Text passText("Pass", font, 24);
-            passText.setFillColor(sf::Color::Black);
-            passText.setPosition(480, 130);
-            window.draw(passText);
-        } else {
-            passBtn.setFillColor(sf::Color(200, 200, 200));
-            window.draw(passBtn);
-            
-            sf::Text passText("Pass", font, 24);
-            passText.setFillColor(sf::Color(128, 128, 128));
-            passText.setPosition(480, 130);
-            window.draw(passText);
+    }
+    
+    // Live search progress while the engine is thinking
+    void drawEngineStatus(sf::RenderWindow& window) {
+        if (font.getInfo().family == "" || !engineRunning) {
+            return;
         }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - engineStart).count();
+        long long nodes = withEngineSearch([](auto& search) { return search.get_nodes_visited(); });
+        std::ostringstream text;
+        text << "Engine thinking... " << (long long)(seconds > 0 ? nodes / seconds / 1000 : 0) << "k nodes/s";
+        engineText.setString(text.str());
+        window.draw(engineText);
+    }
+    
+    bool isGameOver() const {
+        return withGame([](const auto& g) { return g.is_game_over(); });
     }
     
     bool isButtonClicked(int x, int y, int btnX, int btnY, int btnWidth, int btnHeight) {
@@ -248,56 +601,123 @@ private:
     }
 
 public:
-    GoGame() {
+    GoGame()
+        : stoneVertices(sf::Triangles), engineColor(EMPTY), engineRunning(false),
+          engineSize(DEFAULT_BOARD_SIZE), engineJob(0), showOwnership(false), analysisRunning(false), analysisJob(0),
+          analysisShown(0), ownershipVertices(sf::Triangles) {
+        boardLayer.create(BOARD_SIZE_PIXELS + 2 * BOARD_OUTLINE, BOARD_SIZE_PIXELS + 2 * BOARD_OUTLINE);
         loadFont();
+        newGame(DEFAULT_BOARD_SIZE);
         setupUI();
     }
     
+    ~GoGame() {
+        cancelEngine();
+        if (engineThread.joinable()) {
+            engineThread.join();
+        }
+        if (analysisThread.joinable()) {
+            analysisThread.join();
+        }
+    }
+    
     void handleClick(int mouseX, int mouseY) {
         // Check "New Game" button first - this should work even when game is over
         if (isButtonClicked(mouseX, mouseY, 30, 120, 180, 50)) {
-            game.reset();
+            cancelEngine();
+            withGame([](auto& g) { g.reset(); });
             updateUI();
+            startEngine();
+            return;
+        }
+        
+        // A size button starts a new game on that board, also when game is over
+        for (int i = 0; i < 3; i++) {
+            int x = SIZE_BUTTON_X + i * (SIZE_BUTTON_WIDTH + SIZE_BUTTON_GAP);
+            if (isButtonClicked(mouseX, mouseY, x, 120, SIZE_BUTTON_WIDTH, 50)) {
+                newGame(BOARD_SIZES[i]);
+                return;
+            }
+        }
+        
+        // The engine button cycles off, white, black
+        if (isButtonClicked(mouseX, mouseY, ENGINE_BUTTON_X, 120, ENGINE_BUTTON_WIDTH, 50)) {
+            cancelEngine();
+            engineColor = engineColor == EMPTY ? WHITE : engineColor == WHITE ? BLACK : EMPTY;
+            updateButtons();
+            startEngine();
+            return;
+        }
+        
+        // The ownership button shows or hides the overlay and estimate
+        if (isButtonClicked(mouseX, mouseY, ANALYSIS_BUTTON_X, ANALYSIS_BUTTON_Y, ANALYSIS_BUTTON_WIDTH, 50)) {
+            showOwnership = !showOwnership;
+            updateButtons();
+            startAnalysis();
             return;
         }
         
         // If game is over, don't process other clicks
-        if (game.is_game_over()) return;
+        if (isGameOver()) return;
         
         // Check other button clicks (only when game is not over)
         if (isButtonClicked(mouseX, mouseY, 230, 120, 180, 50)) {
-            if (game.undo()) {
+            // Against the engine, undo back to the human's turn
+            cancelEngine();
+            if (withGame([](auto& g) { return g.undo(); })) {
+                if (isEngineTurn()) {
+                    withGame([](auto& g) { return g.undo(); });
+                }
                 updateUI();
             }
+            startEngine();
             return;
         }
         
+        // Moves wait while the engine is to play
+        if (isEngineTurn()) return;
+        
         if (isButtonClicked(mouseX, mouseY, 430, 120, 180, 50)) {
-            game.make_move(-1, -1); // Pass
+            withGame([](auto& g) { return g.make_move(-1, -1); }); // Pass
             updateUI();
+            startEngine();
             return;
         }
         
         // Check board click
         sf::Vector2i coords = getBoardCoords(mouseX, mouseY);
         if (coords.x >= 0 && coords.y >= 0) {
-            if (game.make_move(coords.x, coords.y)) {
+            if (withGame([&](auto& g) { return g.make_move(coords.x, coords.y); })) {
                 updateUI();
+                startEngine();
             }
         }
     }
     
+    // True while an engine search or an analysis is in flight and
+    // render() has to keep polling for its reply
+    bool isThinking() const {
+        return engineRunning || analysisRunning;
+    }
+    
     void render(sf::RenderWindow& window) {
+        pollEngine();
+        pollAnalysis();
+        
         window.clear(BACKGROUND);
         drawBoard(window);
         drawButtons(window);
+        drawEngineStatus(window);
+        if (font.getInfo().family != "" && showOwnership && analysisShown != 0) {
+            window.draw(analysisText);
+        }
         
         if (font.getInfo().family != "") {
             window.draw(currentPlayerText);
             if (!statusMessage.empty()) {
                 window.draw(statusText);
             }
-            if (game.is_game_over()) {
+            if (isGameOver()) {
                 window.draw(scoreText);
             }
         }
@@ -307,24 +727,40 @@ public:
 };
 
 int main() {
-    sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Go 19x19 (C++)");
+    sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Go (C++)");
     window.setFramerateLimit(60);
     
     GoGame goGame;
     
+    // Returns whether the event can change what is on screen
+    auto handleEvent = [&](const sf::Event& event) {
+        if (event.type == sf::Event::Closed) {
+            window.close();
+        } else if (event.type == sf::Event::MouseButtonPressed) {
+            if (event.mouseButton.button == sf::Mouse::Left) {
+                goGame.handleClick(event.mouseButton.x, event.mouseButton.y);
+            }
+        }
+        return event.type != sf::Event::MouseMoved;
+    };
+    
+    // An idle window sleeps in waitEvent and redraws only after an event.
+    // While the engine thinks, frames keep coming at the frame rate limit so
+    // its progress and its move show up without input.
+    bool redraw = true;
     while (window.isOpen()) {
         sf::Event event;
+        if (!redraw && !goGame.isThinking() && window.waitEvent(event)) {
+            redraw = handleEvent(event);
+        }
         while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                window.close();
-            } else if (event.type == sf::Event::MouseButtonPressed) {
-                if (event.mouseButton.button == sf::Mouse::Left) {
-                    goGame.handleClick(event.mouseButton.x, event.mouseButton.y);
-                }
-            }
+            redraw = handleEvent(event) || redraw;
         }
         
-        goGame.render(window);
+        if (window.isOpen() && (redraw || goGame.isThinking())) {
+            goGame.render(window);
+        }
+        redraw = false;
     }
     
     return 0;
@@ -0,0 +1,106 @@
+#include "mapped_file.h"
+#include <fstream>
+#include <iterator>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : bytes(nullptr), length(0), mapping(nullptr), handle(nullptr) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+    if (mapping) {
+#if defined(_WIN32)
+        UnmapViewOfFile(mapping);
+        CloseHandle((HANDLE)handle);
+#else
+        munmap(mapping, length);
+#endif
+    }
+    bytes = nullptr;
+    length = 0;
+    mapping = nullptr;
+    handle = nullptr;
+    buffer.clear();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER file_size;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+            HANDLE view_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (view_handle) {
+                void* view = MapViewOfFile(view_handle, FILE_MAP_READ, 0, 0, 0);
+                if (view) {
+                    mapping = view;
+                    handle = view_handle;
+                    bytes = (const char*)view;
+                    length = (size_t)file_size.QuadPart;
+                } else {
+                    CloseHandle(view_handle);
+                }
+            }
+        }
+        CloseHandle(file);
+        if (mapping) {
+            return true;
+        }
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                // Readers go front to back, so let the kernel read ahead
+                madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+                mapping = view;
+                bytes = (const char*)view;
+                length = (size_t)info.st_size;
+            }
+        }
+        ::close(fd);
+        if (mapping) {
+            return true;
+        }
+    }
+#endif
+
+    // Empty, unmappable or special files are read the ordinary way
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (in.bad()) {
+        buffer.clear();
+        return false;
+    }
+    bytes = buffer.data();
+    length = buffer.size();
+    return true;
+}
+
+const char* MappedFile::data() const {
+    return bytes;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
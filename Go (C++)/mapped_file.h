@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Read-only view of a whole file. Regular files are memory-mapped, so
+// opening a multi-gigabyte archive costs nothing until its pages are read;
+// anything that cannot be mapped (pipes, some network shares) is read into
+// memory instead.
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+    void* mapping;             // the mapped view, or null
+    void* handle;              // Windows file mapping handle, or null
+    std::vector<char> buffer;  // contents when the file is not mapped
+
+    void close();
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if the file cannot be opened or read
+    bool open(const std::string& path);
+
+    const char* data() const;
+    size_t size() const;
+};
+
+#endif // MAPPED_FILE_H
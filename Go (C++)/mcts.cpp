@@ -0,0 +1,484 @@
+#include "mcts.h"
+#include "playout.h"
+#include "score.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+namespace {
+
+constexpr int16_t PASS = -1;
+
+template <int SIZE>
+Position unpack_move(int16_t move) {
+    if (move == PASS) {
+        return Position(-1, -1);
+    }
+    return Position(move % SIZE, move / SIZE);
+}
+
+} // namespace
+
+// Per-thread scratch state: nothing here is shared, so the hot loop never
+// touches memory another thread writes except the node counters
+template <int SIZE>
+struct MctsSearch<SIZE>::Worker {
+    Board<SIZE> board;
+    PlayoutEngine<SIZE> playouts;
+    RegionMap<SIZE> regions;            // scores leaves reached by two passes
+    NodePool::Cursor cursor;
+    std::vector<SearchNode*> path;
+    long long playouts_done;
+    long long nodes_visited;
+    long long nodes_published;          // part of nodes_visited already in nodes_progress
+    
+    explicit Worker(uint64_t seed) : playouts(seed), playouts_done(0), nodes_visited(0), nodes_published(0) {
+        path.reserve(SIZE * SIZE * 3);
+    }
+};
+
+template <int SIZE>
+MctsSearch<SIZE>::MctsSearch(const SearchConfig& config)
+    : config(config), root_color(BLACK), root(NodePool::NO_NODE), stop(false), interrupt_pending(false),
+      playouts_started(0), nodes_progress(0) {
+    if (config.table_megabytes > 0) {
+        table.reset(new TranspositionTable(config.table_megabytes));
+    }
+}
+
+template <int SIZE>
+bool MctsSearch<SIZE>::expand(SearchNode& node, const Board<SIZE>& board, int color,
+                              const Game<SIZE>* game, NodePool::Cursor& cursor) {
+    // Own eyes are left out as in the playouts; pass is only offered when
+    // nothing else is, except at the root where passing can end the game
+    int16_t moves[SIZE * SIZE + 1];
+    int count = 0;
+    for (const auto& pos : board.get_valid_moves(color)) {
+        if (game && !game->is_valid_move(pos.x, pos.y)) {
+            continue;
+        }
+        if (!board.is_eye(pos.x, pos.y, color)) {
+            moves[count++] = (int16_t)(pos.y * SIZE + pos.x);
+        }
+    }
+    if (count == 0 || game) {
+        moves[count++] = PASS;
+    }
+    
+    uint32_t first = pool->allocate(cursor, count);
+    if (first == NodePool::NO_NODE) {
+        return false;
+    }
+    SearchNode* children = &(*pool)[first];
+    for (int i = 0; i < count; i++) {
+        children[i].move = moves[i];
+    }
+    node.children = first;
+    node.child_count = (uint16_t)count;
+    node.state.store(SearchNode::EXPANDED, std::memory_order_release);
+    return true;
+}
+
+template <int SIZE>
+SearchNode* MctsSearch<SIZE>::select_child(SearchNode& node) const {
+    SearchNode* children = &(*pool)[node.children];
+    int parent_visits = node.visits.load(std::memory_order_relaxed)
+                      + node.virtual_loss.load(std::memory_order_relaxed);
+    double log_parent = std::log((double)parent_visits + 1.0);
+    
+    SearchNode* best = &children[0];
+    double best_value = -1.0;
+    for (int i = 0; i < node.child_count; i++) {
+        SearchNode* child = &children[i];
+        int visits = child->visits.load(std::memory_order_relaxed);
+        int wins = child->wins.load(std::memory_order_relaxed);
+        int loss = child->virtual_loss.load(std::memory_order_relaxed);
+        int n = visits + loss;
+        if (n == 0) {
+            // Unvisited children first; virtual loss makes the next thread
+            // pick a different one
+            return child;
+        }
+        // Other paths to the same position may know it better
+        uint64_t ref = child->position_ref.load(std::memory_order_relaxed);
+        TranspositionStats shared;
+        if (ref != TranspositionTable::NO_REF && table->read(ref, shared) && shared.visits > visits) {
+            wins = shared.wins;
+            n = shared.visits + loss;
+        }
+        // Virtual losses count as visits that were lost
+        double value = (double)wins / n + config.exploration * std::sqrt(log_parent / (visits + loss));
+        if (value > best_value) {
+            best_value = value;
+            best = child;
+        }
+    }
+    return best;
+}
+
+template <int SIZE>
+void MctsSearch<SIZE>::run_iteration(Worker& worker) {
+    Board<SIZE>& board = worker.board;
+    board = root_board;
+    worker.path.clear();
+    SearchNode* node = &(*pool)[root];
+    worker.path.push_back(node);
+    
+    // Descend while nodes are expanded, charging a virtual loss to each
+    int color = root_color;
+    int passes = 0;
+    while (passes < 2 && node->state.load(std::memory_order_acquire) == SearchNode::EXPANDED) {
+        node = select_child(*node);
+        node->virtual_loss.fetch_add(config.virtual_loss, std::memory_order_relaxed);
+        worker.path.push_back(node);
+        
+        if (node->move == PASS) {
+            passes++;
+        } else {
+            board.make_move(node->move % SIZE, node->move / SIZE, color);
+            passes = 0;
+        }
+        color = get_opponent(color);
+        
+        // Racing threads reach the same position and store the same entry
+        if (table && node->position_ref.load(std::memory_order_relaxed) == TranspositionTable::NO_REF) {
+            uint64_t ref = table->probe(TranspositionTable::key(board.get_hash(), color));
+            node->position_ref.store(ref, std::memory_order_relaxed);
+        }
+    }
+    
+    int black_score;
+    int white_score;
+    if (passes >= 2) {
+        worker.regions.rebuild(board);
+        auto score = worker.regions.score();
+        black_score = score.first;
+        white_score = score.second;
+    } else {
+        // Only the thread that moves the leaf out of UNEXPANDED builds its
+        // children; any other thread arriving meanwhile just plays out. With
+        // the pool full the leaf stays a leaf.
+        int expected = SearchNode::UNEXPANDED;
+        if (!pool->is_full() &&
+            node->visits.load(std::memory_order_relaxed) + 1 >= config.expand_visits &&
+            node->state.compare_exchange_strong(expected, SearchNode::EXPANDING, std::memory_order_acq_rel) &&
+            !expand(*node, board, color, nullptr, worker.cursor)) {
+            node->state.store(SearchNode::UNEXPANDED, std::memory_order_relaxed);
+        }
+        PlayoutResult result = worker.playouts.run(board, color);
+        black_score = result.black_score;
+        white_score = result.white_score;
+    }
+    bool black_wins = black_score - white_score - config.komi > 0;
+    
+    // path[i] was reached by a move of the root player when i is odd
+    int winner = black_wins ? BLACK : WHITE;
+    int mover = get_opponent(root_color);
+    for (size_t i = 0; i < worker.path.size(); i++) {
+        SearchNode* n = worker.path[i];
+        n->visits.fetch_add(1, std::memory_order_relaxed);
+        if (mover == winner) {
+            n->wins.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (i > 0) {
+            n->virtual_loss.fetch_sub(config.virtual_loss, std::memory_order_relaxed);
+            uint64_t ref = n->position_ref.load(std::memory_order_relaxed);
+            if (ref != TranspositionTable::NO_REF) {
+                table->update(ref, mover == winner);
+            }
+        }
+        mover = get_opponent(mover);
+    }
+    worker.playouts_done++;
+    worker.nodes_visited += (long long)worker.path.size();
+}
+
+template <int SIZE>
+void MctsSearch<SIZE>::run_worker(Worker& worker, double seconds) {
+    auto start = std::chrono::steady_clock::now();
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (config.max_playouts > 0 &&
+            playouts_started.fetch_add(1, std::memory_order_relaxed) >= config.max_playouts) {
+            break;
+        }
+        run_iteration(worker);
+        if (worker.playouts_done % PROGRESS_PLAYOUTS == 0) {
+            nodes_progress.fetch_add(worker.nodes_visited - worker.nodes_published, std::memory_order_relaxed);
+            worker.nodes_published = worker.nodes_visited;
+        }
+        if (seconds > 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= seconds) {
+            stop.store(true, std::memory_order_relaxed);
+        }
+    }
+    // The last batch is short of PROGRESS_PLAYOUTS and would go uncounted
+    nodes_progress.fetch_add(worker.nodes_visited - worker.nodes_published, std::memory_order_relaxed);
+    worker.nodes_published = worker.nodes_visited;
+}
+
+template <int SIZE>
+uint32_t MctsSearch<SIZE>::find_subtree(const Game<SIZE>& game) const {
+    if (root == NodePool::NO_NODE) {
+        return NodePool::NO_NODE;
+    }
+    uint64_t hash = game.get_board().get_hash();
+    int player = game.get_current_player();
+    if (root_board.get_hash() == hash && root_color == player) {
+        return root;
+    }
+    
+    // Hashes without ko or side to move, so the depth is told by the player
+    // to move: one move down it is the opponent's turn, two moves down ours
+    const NodePool& nodes = *pool;
+    const SearchNode& top = nodes[root];
+    if (top.state.load() != SearchNode::EXPANDED) {
+        return NodePool::NO_NODE;
+    }
+    int opponent = get_opponent(root_color);
+    for (uint32_t i = 0; i < top.child_count; i++) {
+        uint32_t index = top.children + i;
+        const SearchNode& child = nodes[index];
+        if (player == opponent) {
+            uint64_t child_hash = child.move == PASS ? root_board.get_hash()
+                : root_board.hash_after_move(child.move % SIZE, child.move / SIZE, root_color);
+            if (child_hash == hash) {
+                return index;
+            }
+            continue;
+        }
+        if (child.state.load() != SearchNode::EXPANDED) {
+            continue;
+        }
+        
+        // Only expanded children can hold the position two moves down
+        Board<SIZE> board = root_board;
+        if (child.move != PASS) {
+            board.make_move(child.move % SIZE, child.move / SIZE, root_color);
+        }
+        for (uint32_t j = 0; j < child.child_count; j++) {
+            const SearchNode& grandchild = nodes[child.children + j];
+            uint64_t grandchild_hash = grandchild.move == PASS ? board.get_hash()
+                : board.hash_after_move(grandchild.move % SIZE, grandchild.move / SIZE, opponent);
+            if (grandchild_hash == hash) {
+                return child.children + j;
+            }
+        }
+    }
+    return NodePool::NO_NODE;
+}
+
+template <int SIZE>
+int MctsSearch<SIZE>::pruning_threshold(uint32_t subtree, size_t target) const {
+    // A child never has more visits than its parent, so cutting every node
+    // below a visit count keeps a connected tree. Sort the expanded nodes
+    // by visits and find the lowest count whose nodes and children all fit.
+    const NodePool& nodes = *pool;
+    std::vector<std::pair<int, int>> expanded;   // (visits, child count)
+    std::vector<uint32_t> stack{subtree};
+    while (!stack.empty()) {
+        const SearchNode& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.state.load(std::memory_order_relaxed) != SearchNode::EXPANDED) {
+            continue;
+        }
+        expanded.emplace_back(node.visits.load(std::memory_order_relaxed), node.child_count);
+        for (uint32_t i = 0; i < node.child_count; i++) {
+            stack.push_back(node.children + i);
+        }
+    }
+    std::sort(expanded.begin(), expanded.end(), std::greater<std::pair<int, int>>());
+    
+    size_t kept = 1;
+    size_t i = 0;
+    while (i < expanded.size()) {
+        // Nodes with equal visits are kept or cut together
+        int visits = expanded[i].first;
+        size_t group = 0;
+        for (; i < expanded.size() && expanded[i].first == visits; i++) {
+            group += (size_t)expanded[i].second;
+        }
+        if (kept + group > target) {
+            return visits + 1;
+        }
+        kept += group;
+    }
+    return 0;
+}
+
+template <int SIZE>
+size_t MctsSearch<SIZE>::reuse_subtree(uint32_t subtree, const Game<SIZE>& game) {
+    int threshold = pruning_threshold(subtree, config.max_nodes / 2);
+    std::unique_ptr<NodePool> old_pool = std::move(pool);
+    const NodePool& old_nodes = *old_pool;
+    pool.reset(new NodePool(config.max_nodes));
+    NodePool& nodes = *pool;
+    
+    // The root's children are rebuilt for the game, which knows about
+    // superko and passing; the old children's subtrees are then moved
+    // under the new children with the same move
+    NodePool::Cursor cursor;
+    root = nodes.allocate(cursor, 1);
+    root_board = game.get_board();
+    root_color = game.get_current_player();
+    const SearchNode& old_top = old_nodes[subtree];
+    SearchNode& top = nodes[root];
+    top.visits.store(old_top.visits.load());
+    top.wins.store(old_top.wins.load());
+    expand(top, root_board, root_color, &game, cursor);
+    size_t reused = 1;
+    if (old_top.state.load() != SearchNode::EXPANDED) {
+        return reused;
+    }
+    
+    int16_t new_index[SIZE * SIZE + 1];
+    std::fill(new_index, new_index + SIZE * SIZE + 1, -1);
+    for (int i = 0; i < top.child_count; i++) {
+        new_index[nodes[top.children + i].move + 1] = (int16_t)i;
+    }
+    std::vector<std::pair<const SearchNode*, SearchNode*>> stack;
+    for (int i = 0; i < old_top.child_count; i++) {
+        const SearchNode& from = old_nodes[old_top.children + i];
+        int index = new_index[from.move + 1];
+        if (index >= 0) {
+            stack.emplace_back(&from, &nodes[top.children + index]);
+        }
+    }
+    
+    while (!stack.empty()) {
+        const SearchNode& from = *stack.back().first;
+        SearchNode& to = *stack.back().second;
+        stack.pop_back();
+        to.visits.store(from.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        to.wins.store(from.wins.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        to.position_ref.store(from.position_ref.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        reused++;
+        if (from.state.load(std::memory_order_relaxed) != SearchNode::EXPANDED ||
+            from.visits.load(std::memory_order_relaxed) < threshold) {
+            continue;
+        }
+        
+        uint32_t first = nodes.allocate(cursor, from.child_count);
+        if (first == NodePool::NO_NODE) {
+            continue;
+        }
+        for (uint32_t i = 0; i < from.child_count; i++) {
+            nodes[first + i].move = old_nodes[from.children + i].move;
+            stack.emplace_back(&old_nodes[from.children + i], &nodes[first + i]);
+        }
+        to.children = first;
+        to.child_count = from.child_count;
+        to.state.store(SearchNode::EXPANDED, std::memory_order_relaxed);
+    }
+    return reused;
+}
+
+template <int SIZE>
+void MctsSearch<SIZE>::clear() {
+    pool.reset();
+    root = NodePool::NO_NODE;
+    if (table) {
+        table->clear();
+    }
+}
+
+template <int SIZE>
+SearchResult MctsSearch<SIZE>::search(const Game<SIZE>& game) {
+    SearchResult result{Position(-1, -1), {}, 0, 0.0, {}, 0, 0, {0, 0, 0}};
+    if (game.is_game_over()) {
+        interrupt_pending.store(false);
+        return result;
+    }
+    
+    uint32_t subtree = find_subtree(game);
+    if (subtree != NodePool::NO_NODE) {
+        result.reused_nodes = reuse_subtree(subtree, game);
+    } else {
+        pool.reset(new NodePool(config.max_nodes));
+        NodePool::Cursor cursor;
+        root = pool->allocate(cursor, 1);
+        root_board = game.get_board();
+        root_color = game.get_current_player();
+        expand((*pool)[root], root_board, root_color, &game, cursor);
+    }
+    stop.store(interrupt_pending.exchange(false));
+    playouts_started.store(0);
+    nodes_progress.store(0, std::memory_order_relaxed);
+    
+    int thread_count = config.threads > 0 ? config.threads : (int)std::thread::hardware_concurrency();
+    thread_count = std::max(thread_count, 1);
+    // A search with neither limit would never end
+    double seconds = config.seconds > 0 || config.max_playouts > 0 ? config.seconds : 1.0;
+    
+    std::vector<Worker> workers;
+    workers.reserve(thread_count);
+    for (int i = 0; i < thread_count; i++) {
+        workers.emplace_back(config.seed + 0x9E3779B97F4A7C15ULL * (uint64_t)i);
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 1; i < thread_count; i++) {
+        threads.emplace_back(&MctsSearch::run_worker, this, std::ref(workers[i]), seconds);
+    }
+    run_worker(workers[0], seconds);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // An interrupt that arrived while this search ran has been served
+    interrupt_pending.store(false);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    for (const auto& worker : workers) {
+        result.playouts += worker.playouts_done;
+        double rate = result.seconds > 0 ? worker.nodes_visited / result.seconds : 0.0;
+        result.threads.push_back(ThreadStats{worker.playouts_done, rate});
+    }
+    
+    const SearchNode& top = (*pool)[root];
+    for (int i = 0; i < top.child_count; i++) {
+        const SearchNode& child = (*pool)[top.children + i];
+        int visits = child.visits.load();
+        double win_rate = visits > 0 ? (double)child.wins.load() / visits : 0.0;
+        result.moves.push_back(MoveStats{unpack_move<SIZE>(child.move), visits, win_rate});
+    }
+    std::stable_sort(result.moves.begin(), result.moves.end(),
+                     [](const MoveStats& a, const MoveStats& b) { return a.visits > b.visits; });
+    if (!result.moves.empty()) {
+        result.best_move = result.moves[0].move;
+    }
+    result.tree_nodes = pool->size();
+    if (table) {
+        result.transpositions = table->get_counters();
+    }
+    return result;
+}
+
+template <int SIZE>
+void MctsSearch<SIZE>::interrupt() {
+    // Pending first: a search that sees stop clears it only after its
+    // threads have stopped, so it cannot leak into the next search
+    interrupt_pending.store(true);
+    stop.store(true);
+}
+
+template <int SIZE>
+void MctsSearch<SIZE>::cancel_interrupt() {
+    interrupt_pending.store(false);
+}
+
+template <int SIZE>
+long long MctsSearch<SIZE>::get_nodes_visited() const {
+    return nodes_progress.load(std::memory_order_relaxed);
+}
+
+template <int SIZE>
+void MctsSearch<SIZE>::set_limits(double seconds, long long max_playouts) {
+    config.seconds = seconds;
+    config.max_playouts = max_playouts;
+}
+
+template class MctsSearch<9>;
+template class MctsSearch<13>;
+template class MctsSearch<19>;
@@ -0,0 +1,118 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "game.h"
+#include "node_pool.h"
+#include "transposition.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// Search budget and tuning. The search stops at whichever of the time and
+// playout limits is reached first; a limit of 0 is ignored.
+struct SearchConfig {
+    int threads = 1;             // 0 uses every hardware thread
+    double seconds = 1.0;
+    long long max_playouts = 0;
+    double komi = 7.5;
+    double exploration = 1.0;    // UCT exploration constant
+    int virtual_loss = 3;        // losses charged to a node per thread below it
+    int expand_visits = 2;       // visits before a leaf gets children
+    size_t max_nodes = 1 << 22;  // tree size cap; a reused subtree keeps at most half
+    size_t table_megabytes = 64; // transposition table size, 0 for none
+    uint64_t seed = 1;
+};
+
+struct MoveStats {
+    Position move;               // (-1, -1) for a pass
+    int visits;
+    double win_rate;             // for the player to move at the root
+};
+
+struct ThreadStats {
+    long long playouts;
+    double nodes_per_second;     // tree nodes visited per second
+};
+
+struct SearchResult {
+    Position best_move;          // most visited root move, (-1, -1) for a pass
+    std::vector<MoveStats> moves;  // visit distribution, most visited first
+    long long playouts;
+    double seconds;
+    std::vector<ThreadStats> threads;
+    size_t reused_nodes;         // nodes carried over from the previous search
+    size_t tree_nodes;           // pool size when the search ended, in whole chunks
+    TranspositionCounters transpositions;  // since the table was created or cleared
+};
+
+// Monte Carlo tree search with UCT selection, parallelized over one shared
+// tree. Node counters are atomics, so threads never take a lock: a thread
+// charges virtual losses to the nodes on its path so others spread out to
+// different lines, and a leaf is expanded by the one thread that wins a
+// compare-and-swap on its state. Playouts run on each thread's own Board.
+//
+// Nodes come from a NodePool capped at max_nodes; once it is full, leaves
+// stop being expanded. The tree outlives a search: when the next position
+// is the old root or one or two moves below it, the matching subtree is
+// copied into a fresh pool, dropping the children of its least-visited
+// nodes, and the rest is freed with the old pool.
+//
+// Each node visited is linked to the TranspositionTable entry for its
+// position, which collects the results of every path through that
+// position. Selection uses the entry's win rate when it has seen more
+// playouts than the node itself. The table is kept across searches.
+template <int SIZE>
+class MctsSearch {
+private:
+    struct Worker;
+    
+    SearchConfig config;
+    std::unique_ptr<NodePool> pool;
+    std::unique_ptr<TranspositionTable> table;  // null when disabled
+    Board<SIZE> root_board;
+    int root_color;
+    uint32_t root;                      // NodePool::NO_NODE when there is no tree
+    std::atomic<bool> stop;
+    std::atomic<bool> interrupt_pending;  // interrupt() not yet seen by a search
+    std::atomic<long long> playouts_started;
+    std::atomic<long long> nodes_progress;  // tree nodes visited, published every PROGRESS_PLAYOUTS playouts
+    
+    static constexpr int PROGRESS_PLAYOUTS = 64;
+    
+    bool expand(SearchNode& node, const Board<SIZE>& board, int color,
+                const Game<SIZE>* game, NodePool::Cursor& cursor);
+    SearchNode* select_child(SearchNode& node) const;
+    void run_iteration(Worker& worker);
+    void run_worker(Worker& worker, double seconds);
+    
+    uint32_t find_subtree(const Game<SIZE>& game) const;
+    int pruning_threshold(uint32_t subtree, size_t target) const;
+    size_t reuse_subtree(uint32_t subtree, const Game<SIZE>& game);
+
+public:
+    explicit MctsSearch(const SearchConfig& config);
+    
+    SearchResult search(const Game<SIZE>& game);
+    // Makes the search() running on another thread return once each of
+    // its threads finishes the playout in hand; if none is running yet,
+    // the next search() returns at once instead. Lets a ponder search
+    // yield to the next command.
+    void interrupt();
+    // Drops an interrupt() that no search has seen, as when it came after
+    // the search it was meant for had already returned. Call it once the
+    // thread that ran that search has been joined.
+    void cancel_interrupt();
+    // Tree nodes visited so far by the running search, or by the last one
+    // once it has returned. Threads add to it every few dozen playouts, so
+    // another thread can poll it for a progress display.
+    long long get_nodes_visited() const;
+    // Time and playout limits for the searches that follow, as in SearchConfig
+    void set_limits(double seconds, long long max_playouts);
+    // Forget the tree and the transposition table, so the next search
+    // starts from scratch
+    void clear();
+};
+
+#endif // MCTS_H
+
@@ -0,0 +1,64 @@
+#include "node_pool.h"
+#include <algorithm>
+
+NodePool::NodePool(size_t max_nodes) : chunks_claimed(0), full(false) {
+    // Indices are 32 bits and NO_NODE must stay out of range
+    size_t chunks = max_nodes >> CHUNK_SHIFT;
+    chunks = std::min(chunks, (size_t)(NO_NODE >> CHUNK_SHIFT));
+    chunk_limit = (uint32_t)std::max(chunks, (size_t)1);
+    
+    // Slabs are allocated as chunks in them are claimed; the table itself
+    // never resizes, so readers can index it without the lock
+    size_t slab_count = (capacity() + SLAB_SIZE - 1) >> SLAB_SHIFT;
+    slabs.resize(slab_count);
+}
+
+bool NodePool::claim_chunk(Cursor& cursor) {
+    if (full.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t chunk = chunks_claimed.load(std::memory_order_relaxed);
+    if (chunk >= chunk_limit) {
+        full.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    
+    uint32_t first = chunk << CHUNK_SHIFT;
+    size_t slab = first >> SLAB_SHIFT;
+    if (!slabs[slab]) {
+        // The last slab is cut to the budget
+        size_t slab_start = slab << SLAB_SHIFT;
+        size_t nodes = std::min((size_t)SLAB_SIZE, capacity() - slab_start);
+        slabs[slab].reset(new SearchNode[nodes]);
+    }
+    chunks_claimed.store(chunk + 1, std::memory_order_relaxed);
+    
+    cursor.next = first;
+    cursor.end = first + CHUNK_SIZE;
+    return true;
+}
+
+uint32_t NodePool::allocate(Cursor& cursor, int count) {
+    // A block never straddles chunks; the tail of the old chunk is wasted,
+    // which is at most one child list out of a chunk
+    if (cursor.end - cursor.next < (uint32_t)count && !claim_chunk(cursor)) {
+        return NO_NODE;
+    }
+    uint32_t first = cursor.next;
+    cursor.next += (uint32_t)count;
+    return first;
+}
+
+bool NodePool::is_full() const {
+    return full.load(std::memory_order_relaxed);
+}
+
+size_t NodePool::size() const {
+    return (size_t)chunks_claimed.load(std::memory_order_relaxed) << CHUNK_SHIFT;
+}
+
+size_t NodePool::capacity() const {
+    return (size_t)chunk_limit << CHUNK_SHIFT;
+}
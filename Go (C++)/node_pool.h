@@ -0,0 +1,77 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// One search tree node. A node's children are a contiguous block in the
+// pool, named by the 32-bit index of the first one.
+struct SearchNode {
+    enum State { UNEXPANDED, EXPANDING, EXPANDED };
+    
+    int16_t move;                   // y * SIZE + x, or -1 for a pass
+    uint16_t child_count;
+    uint32_t children;              // valid once state is EXPANDED
+    std::atomic<int> visits;
+    std::atomic<int> wins;          // for the player who made move
+    std::atomic<int> virtual_loss;
+    std::atomic<int> state;
+    std::atomic<uint64_t> position_ref; // transposition table entry, UINT64_MAX if none
+    
+    SearchNode()
+        : move(-1), child_count(0), children(0), visits(0), wins(0), virtual_loss(0),
+          state(UNEXPANDED), position_ref(UINT64_MAX) {}
+};
+
+// Arena for search nodes. Nodes live in fixed-size slabs that never move
+// and are all freed with the pool, so dropping a tree costs one free per
+// slab. Each thread claims a whole chunk under the lock and then carves
+// child blocks out of it with a bump pointer; the lock is taken once every
+// few thousand nodes. The pool never grows past its node budget: once the
+// budget is used up, allocation fails.
+class NodePool {
+public:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr int CHUNK_SHIFT = 12;     // 4096 nodes per chunk
+    static constexpr int SLAB_SHIFT = 16;      // 65536 nodes per slab
+    static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_SHIFT;
+    static constexpr uint32_t SLAB_SIZE = 1u << SLAB_SHIFT;
+    
+    // A thread's position in the chunk it owns. Chunks are never shared,
+    // so allocating from a cursor needs no synchronization.
+    class Cursor {
+    private:
+        friend class NodePool;
+        uint32_t next = 0;
+        uint32_t end = 0;
+    };
+    
+    explicit NodePool(size_t max_nodes);
+    
+    SearchNode& operator[](uint32_t index) const {
+        return slabs[index >> SLAB_SHIFT][index & (SLAB_SIZE - 1)];
+    }
+    
+    // count contiguous nodes (count <= CHUNK_SIZE), or NO_NODE when the
+    // node budget is used up
+    uint32_t allocate(Cursor& cursor, int count);
+    
+    bool is_full() const;
+    size_t size() const;        // nodes in claimed chunks
+    size_t capacity() const;    // node budget, rounded down to whole chunks
+
+private:
+    std::vector<std::unique_ptr<SearchNode[]>> slabs;
+    uint32_t chunk_limit;
+    std::atomic<uint32_t> chunks_claimed;
+    std::atomic<bool> full;
+    std::mutex mutex;
+    
+    bool claim_chunk(Cursor& cursor);
+};
+
+#endif // NODE_POOL_H
@@ -0,0 +1,321 @@
+#include "opening_book.h"
+#include "game_record.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+constexpr char BOOK_MAGIC[4] = {'G', 'O', 'B', '1'};
+constexpr size_t BOOK_HEADER_BYTES = 16;
+constexpr size_t BOOK_ENTRY_BYTES = 24;
+
+// XORed into the canonical hash when White is to move
+constexpr uint64_t WHITE_TO_MOVE_KEY = 0x8F1BBCDCCA62C1D6ULL;
+
+// Interpolation probes before a lookup falls back to bisection, which
+// bounds the cost when keys happen to cluster
+constexpr int INTERPOLATION_PROBES = 8;
+
+void put(uint8_t* bytes, uint64_t value, int count) {
+    for (int i = 0; i < count; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+uint64_t get(const uint8_t* bytes, int count) {
+    uint64_t value = 0;
+    for (int i = 0; i < count; i++) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+struct BookEntry {
+    uint64_t key;
+    uint16_t move;
+    uint32_t games;
+    uint32_t wins;
+};
+
+// The canonical hash is the smallest of eight and so leans toward small
+// values; the splitmix64 finalizer spreads keys evenly again, which the
+// interpolation in lower_bound() relies on
+template <int SIZE>
+uint64_t position_key(const Board<SIZE>& board, int to_move) {
+    uint64_t z = board.get_canonical_hash();
+    if (to_move == WHITE) {
+        z ^= WHITE_TO_MOVE_KEY;
+    }
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Index of move in the canonical orientation. A symmetric position has
+// several symmetries that reach its canonical hash, and so several images
+// of an equivalent move; the smallest is kept so that they count as one.
+template <int SIZE>
+uint16_t canonical_move(const Board<SIZE>& board, Position move) {
+    uint64_t canonical = board.get_canonical_hash();
+    int best = INT_MAX;
+    for (int s = 0; s < SYMMETRIES; s++) {
+        if (board.get_symmetry_hash(s) == canonical) {
+            Position image = apply_symmetry(move, s, SIZE);
+            best = std::min(best, image.y * SIZE + image.x);
+        }
+    }
+    return (uint16_t)best;
+}
+
+// Sorts entries by key and move and adds up the counts of equal ones
+void merge_entries(std::vector<BookEntry>& entries) {
+    std::sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+        return std::tie(a.key, a.move) < std::tie(b.key, b.move);
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (kept > 0 && entries[kept - 1].key == entries[i].key && entries[kept - 1].move == entries[i].move) {
+            entries[kept - 1].games += entries[i].games;
+            entries[kept - 1].wins += entries[i].wins;
+        } else {
+            entries[kept++] = entries[i];
+        }
+    }
+    entries.resize(kept);
+}
+
+struct RecordSpan {
+    const char* begin;
+    size_t length;
+};
+
+template <int SIZE>
+void collect_book_moves(const std::vector<RecordSpan>& spans, std::atomic<size_t>& next_span, int max_moves,
+                        std::vector<BookEntry>& entries) {
+    // Records hold legal games, so a bare Board replays them: Game would
+    // also keep the superko history and territory map up to date
+    std::unique_ptr<Board<SIZE>> board(new Board<SIZE>());
+    GameRecord record;
+    for (;;) {
+        size_t index = next_span.fetch_add(1, std::memory_order_relaxed);
+        if (index >= spans.size()) {
+            break;
+        }
+        if (decode_game_record(spans[index].begin, spans[index].length, record) == 0 || record.board_size != SIZE) {
+            continue;
+        }
+        board->clear();
+        for (int16_t point : record.black_setup) {
+            board->set(point % SIZE, point / SIZE, BLACK);
+        }
+        for (int16_t point : record.white_setup) {
+            board->set(point % SIZE, point / SIZE, WHITE);
+        }
+        int winner = record.black_score - record.white_score - record.komi > 0 ? BLACK : WHITE;
+        int to_move = record.white_first ? WHITE : BLACK;
+        for (size_t i = 0; i < record.moves.size() && i < (size_t)max_moves; i++) {
+            // The book is for openings; a pass ends the part worth keeping
+            if (record.moves[i] < 0) {
+                break;
+            }
+            Position move(record.moves[i] % SIZE, record.moves[i] / SIZE);
+            entries.push_back(BookEntry{position_key(*board, to_move), canonical_move(*board, move), 1,
+                                        to_move == winner ? 1u : 0u});
+            if (!board->make_move(move.x, move.y, to_move)) {
+                break;
+            }
+            to_move = get_opponent(to_move);
+        }
+    }
+    // Each worker merges its own share, so the final merge sees every
+    // position once per worker rather than once per game
+    merge_entries(entries);
+}
+
+} // namespace
+
+OpeningBook::OpeningBook() : entries(nullptr), entry_count(0), board_size(0) {}
+
+bool OpeningBook::open(const std::string& path) {
+    entry_count = 0;
+    board_size = 0;
+    if (!file.open(path) || file.size() < BOOK_HEADER_BYTES ||
+        !std::equal(BOOK_MAGIC, BOOK_MAGIC + 4, file.data())) {
+        return false;
+    }
+    const uint8_t* header = (const uint8_t*)file.data();
+    int size = (int)get(header + 4, 4);
+    size_t entries_in_book = (size_t)get(header + 8, 8);
+    if (!is_supported_board_size(size) || file.size() != BOOK_HEADER_BYTES + entries_in_book * BOOK_ENTRY_BYTES) {
+        return false;
+    }
+    entries = header + BOOK_HEADER_BYTES;
+    entry_count = entries_in_book;
+    board_size = size;
+    return true;
+}
+
+int OpeningBook::get_board_size() const {
+    return board_size;
+}
+
+size_t OpeningBook::get_entry_count() const {
+    return entry_count;
+}
+
+size_t OpeningBook::lower_bound(uint64_t key) const {
+    auto key_at = [&](size_t i) { return get(entries + i * BOOK_ENTRY_BYTES, 8); };
+    
+    // The answer stays within [low, high]. Each probe guesses its place
+    // from where key falls between the first and last key of the range.
+    size_t low = 0;
+    size_t high = entry_count;
+    for (int probe = 0; probe < INTERPOLATION_PROBES && high - low > 2; probe++) {
+        uint64_t low_key = key_at(low);
+        uint64_t high_key = key_at(high - 1);
+        if (key <= low_key) {
+            return low;
+        }
+        if (key > high_key) {
+            return high;
+        }
+        double fraction = (double)(key - low_key) / (double)(high_key - low_key);
+        size_t guess = low + 1 + (size_t)(fraction * (double)(high - low - 2));
+        if (key_at(guess) < key) {
+            low = guess + 1;
+        } else {
+            high = guess;
+        }
+    }
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (key_at(middle) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+template <int SIZE>
+std::vector<BookMove> OpeningBook::find(const Board<SIZE>& board, int to_move) const {
+    std::vector<BookMove> moves;
+    if (board_size != SIZE) {
+        return moves;
+    }
+    uint64_t key = position_key(board, to_move);
+    int back = inverse_symmetry(board.get_canonical_symmetry());
+    for (size_t i = lower_bound(key); i < entry_count; i++) {
+        const uint8_t* entry = entries + i * BOOK_ENTRY_BYTES;
+        if (get(entry, 8) != key) {
+            break;
+        }
+        int point = (int)get(entry + 8, 2);
+        Position move = apply_symmetry(Position(point % SIZE, point / SIZE), back, SIZE);
+        // A hash collision could name an occupied point; never return one
+        if (point < SIZE * SIZE && board.is_valid_move(move.x, move.y, to_move)) {
+            moves.push_back(BookMove{move, (uint32_t)get(entry + 12, 4), (uint32_t)get(entry + 16, 4)});
+        }
+    }
+    std::stable_sort(moves.begin(), moves.end(), [](const BookMove& a, const BookMove& b) {
+        return a.games > b.games;
+    });
+    return moves;
+}
+
+bool build_opening_book(const std::vector<std::string>& record_paths, const std::string& book_path,
+                        const OpeningBookOptions& options, std::string& error) {
+    if (!is_supported_board_size(options.board_size)) {
+        error = "unsupported board size " + std::to_string(options.board_size);
+        return false;
+    }
+    
+    // Find where each record starts; decoding and replaying them is the
+    // part that runs in parallel
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<RecordSpan> spans;
+    GameRecord record;
+    for (const auto& path : record_paths) {
+        files.emplace_back(new MappedFile());
+        MappedFile& records = *files.back();
+        if (!records.open(path) || !is_game_record_stream(records.data(), records.size())) {
+            error = path + " is not a game record stream";
+            return false;
+        }
+        size_t offset = GAME_RECORD_MAGIC_BYTES;
+        while (offset < records.size()) {
+            size_t length = decode_game_record(records.data() + offset, records.size() - offset, record);
+            if (length == 0) {
+                error = path + ": truncated or corrupt record at byte " + std::to_string(offset);
+                return false;
+            }
+            spans.push_back(RecordSpan{records.data() + offset, length});
+            offset += length;
+        }
+    }
+    
+    int thread_count = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+    thread_count = std::max(1, std::min(thread_count, (int)std::max(spans.size(), (size_t)1)));
+    std::atomic<size_t> next_span(0);
+    std::vector<std::vector<BookEntry>> parts(thread_count);
+    dispatch_board_size(options.board_size, [&](auto board_size) {
+        constexpr int SIZE = decltype(board_size)::value;
+        std::vector<std::thread> workers;
+        for (int t = 1; t < thread_count; t++) {
+            workers.emplace_back(collect_book_moves<SIZE>, std::cref(spans), std::ref(next_span), options.moves,
+                                 std::ref(parts[t]));
+        }
+        collect_book_moves<SIZE>(spans, next_span, options.moves, parts[0]);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    });
+    
+    std::vector<BookEntry> book_entries;
+    for (auto& part : parts) {
+        book_entries.insert(book_entries.end(), part.begin(), part.end());
+        std::vector<BookEntry>().swap(part);
+    }
+    merge_entries(book_entries);
+    book_entries.erase(std::remove_if(book_entries.begin(), book_entries.end(), [&](const BookEntry& entry) {
+        return entry.games < (uint32_t)std::max(options.min_games, 1);
+    }), book_entries.end());
+    
+    std::ofstream out(book_path, std::ios::binary);
+    uint8_t header[BOOK_HEADER_BYTES] = {};
+    std::copy(BOOK_MAGIC, BOOK_MAGIC + 4, header);
+    put(header + 4, options.board_size, 4);
+    put(header + 8, book_entries.size(), 8);
+    out.write((const char*)header, sizeof(header));
+    
+    // Entries go out in blocks rather than one write each
+    std::vector<uint8_t> block;
+    for (size_t i = 0; i < book_entries.size(); i++) {
+        uint8_t entry[BOOK_ENTRY_BYTES] = {};
+        put(entry, book_entries[i].key, 8);
+        put(entry + 8, book_entries[i].move, 2);
+        put(entry + 12, book_entries[i].games, 4);
+        put(entry + 16, book_entries[i].wins, 4);
+        block.insert(block.end(), entry, entry + BOOK_ENTRY_BYTES);
+        if (block.size() >= (1 << 20) || i + 1 == book_entries.size()) {
+            out.write((const char*)block.data(), (std::streamsize)block.size());
+            block.clear();
+        }
+    }
+    out.flush();
+    if (!out) {
+        error = "cannot write " + book_path;
+        return false;
+    }
+    return true;
+}
+
+template std::vector<BookMove> OpeningBook::find<9>(const Board<9>& board, int to_move) const;
+template std::vector<BookMove> OpeningBook::find<13>(const Board<13>& board, int to_move) const;
+template std::vector<BookMove> OpeningBook::find<19>(const Board<19>& board, int to_move) const;
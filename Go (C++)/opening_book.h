@@ -0,0 +1,72 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include "board.h"
+#include "mapped_file.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct BookMove {
+    Position move;             // on the board that was looked up
+    uint32_t games;            // record games that played it from this position
+    uint32_t wins;             // of those, the ones the player to move won
+};
+
+// Move statistics by position, read from the file build_opening_book()
+// writes. A position is keyed by its canonical hash (see
+// Board::get_canonical_hash) and the side to move, so all eight rotations
+// and mirror images of an opening share one set of entries. Moves are
+// stored in the canonical orientation and mapped back onto the board being
+// looked up. The file is memory-mapped and searched in place.
+//
+// Book layout, all integers little-endian:
+//
+//   "GOB1", u32 board size, u64 entry count
+//   per entry, by key then move: u64 key, u16 move (y * size + x in the
+//   canonical orientation), u16 0, u32 games, u32 wins, u32 0
+//
+// Keys are Zobrist hashes, spread evenly over 64 bits, so lookups
+// interpolate between the keys at the ends of the range instead of halving
+// it and need a handful of probes even in a large book.
+class OpeningBook {
+private:
+    MappedFile file;
+    const uint8_t* entries;
+    size_t entry_count;
+    int board_size;
+    
+    // First entry whose key is not below key
+    size_t lower_bound(uint64_t key) const;
+
+public:
+    OpeningBook();
+    
+    // False if the file is missing or not a book
+    bool open(const std::string& path);
+    
+    int get_board_size() const;
+    size_t get_entry_count() const;
+    // Legal moves the book has for board with to_move to play, most played
+    // first; empty when the position is not in the book or the book is for
+    // another board size
+    template <int SIZE>
+    std::vector<BookMove> find(const Board<SIZE>& board, int to_move) const;
+};
+
+struct OpeningBookOptions {
+    int board_size = DEFAULT_BOARD_SIZE;   // records of other sizes are skipped
+    int moves = 30;                        // moves taken from the start of each game
+    int min_games = 2;                     // moves played in fewer games are dropped
+    int threads = 0;                       // 0 uses every hardware thread
+};
+
+// Writes a book from the games of one or more record streams. Worker
+// threads take records off a shared counter, replay their opening moves
+// and count them under each position's key; the counts are then merged and
+// sorted. A game counts as won by the side its final score favors. On
+// failure error says why.
+bool build_opening_book(const std::vector<std::string>& record_paths, const std::string& book_path,
+                        const OpeningBookOptions& options, std::string& error);
+
+#endif // OPENING_BOOK_H
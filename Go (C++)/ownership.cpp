@@ -0,0 +1,236 @@
+#include "ownership.h"
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// A chain outside every unconditional eye is dead when the playouts give
+// its stones to the opponent by at least this mean ownership margin
+constexpr double DEAD_OWNERSHIP = 0.5;
+
+// int16 ownership sums are added to the totals before they can overflow
+constexpr int FLUSH_PLAYOUTS = 32767;
+
+// Owner of every point of a finished playout, y * SIZE + x: +1 black, -1
+// white, 0 neutral. Only eyes and dame are left empty by then, so an empty
+// point belongs to whoever surrounds its region. regions is scratch space,
+// rebuilt for board, so a thread scores every playout with one map.
+template <int SIZE>
+void final_owners(const Board<SIZE>& board, RegionMap<SIZE>& regions, int16_t* owners) {
+    regions.rebuild(board);
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            int owner = board.get(x, y);
+            if (owner == EMPTY) {
+                owner = regions.get_owner(x, y);
+            }
+            owners[y * SIZE + x] = owner == BLACK ? 1 : owner == WHITE ? -1 : 0;
+        }
+    }
+}
+
+// What one thread's playouts add up to
+struct PlayoutSums {
+    std::vector<int32_t> owner_sum;   // black minus white final owners
+    int playouts;
+    int black_wins;
+    double score_sum;                 // black minus white, komi included
+    double score_square_sum;
+};
+
+// Plays playouts random games from board with engine and sums their
+// outcome, the one loop behind both OwnershipMap and analyze_ownership
+template <int SIZE>
+PlayoutSums run_playouts(PlayoutEngine<SIZE>& engine, RegionMap<SIZE>& regions, const Board<SIZE>& board,
+                         int to_move, double komi, int playouts) {
+    PlayoutSums sums{std::vector<int32_t>(SIZE * SIZE, 0), playouts, 0, 0.0, 0.0};
+    int16_t owners[SIZE * SIZE];
+    int16_t counts[SIZE * SIZE] = {};
+    
+    auto flush = [&]() {
+        for (int p = 0; p < SIZE * SIZE; p++) {
+            sums.owner_sum[p] += counts[p];
+            counts[p] = 0;
+        }
+    };
+    for (int i = 0; i < playouts; i++) {
+        PlayoutResult result = engine.run(board, to_move);
+        double score = result.black_score - result.white_score - komi;
+        sums.black_wins += score > 0;
+        sums.score_sum += score;
+        sums.score_square_sum += score * score;
+        // A flat int16 add over the whole board, which compilers vectorize
+        final_owners(engine.get_board(), regions, owners);
+        for (int p = 0; p < SIZE * SIZE; p++) {
+            counts[p] += owners[p];
+        }
+        if ((i + 1) % FLUSH_PLAYOUTS == 0) {
+            flush();
+        }
+    }
+    flush();
+    return sums;
+}
+
+template <int SIZE>
+void run_analysis_part(const Board<SIZE>& board, int to_move, double komi, int playouts, uint64_t seed,
+                       PlayoutSums& part) {
+    PlayoutEngine<SIZE> engine(seed);
+    std::unique_ptr<RegionMap<SIZE>> regions(new RegionMap<SIZE>());
+    part = run_playouts(engine, *regions, board, to_move, komi, playouts);
+}
+
+} // namespace
+
+template <int SIZE>
+OwnershipMap<SIZE>::OwnershipMap(uint64_t seed) : engine(seed), playouts(0), black_wins(0) {
+    std::fill(owner_sum, owner_sum + SIZE * SIZE, 0);
+}
+
+template <int SIZE>
+void OwnershipMap<SIZE>::estimate(const Board<SIZE>& board, int to_move, int count, double komi) {
+    PlayoutSums sums = run_playouts(engine, regions, board, to_move, komi, std::max(count, 0));
+    std::copy(sums.owner_sum.begin(), sums.owner_sum.end(), owner_sum);
+    playouts = sums.playouts;
+    black_wins = sums.black_wins;
+}
+
+template <int SIZE>
+double OwnershipMap<SIZE>::get(int x, int y) const {
+    return playouts > 0 ? (double)owner_sum[y * SIZE + x] / playouts : 0.0;
+}
+
+template <int SIZE>
+double OwnershipMap<SIZE>::get_black_win_rate() const {
+    return playouts > 0 ? (double)black_wins / playouts : 0.5;
+}
+
+template <int SIZE>
+int OwnershipMap<SIZE>::get_playouts() const {
+    return playouts;
+}
+
+template <int SIZE>
+ScoreEstimate estimate_final_score(const Board<SIZE>& board, int to_move, double komi, int playouts,
+                                   uint64_t seed) {
+    Bitboard<SIZE> alive[2] = {find_unconditional_life(board, BLACK), find_unconditional_life(board, WHITE)};
+    std::unique_ptr<OwnershipMap<SIZE>> ownership(new OwnershipMap<SIZE>(seed));
+    ownership->estimate(board, to_move, playouts, komi);
+    
+    // Decided chain by chain, so a chain never comes off the board in part
+    ScoreEstimate estimate{0, 0, 0.0, {}};
+    Board<SIZE> scored = board;
+    Bitboard<SIZE> seen;
+    std::vector<Position> chain;
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            int color = board.get(x, y);
+            if (color == EMPTY || seen.test(x, y)) {
+                continue;
+            }
+            chain.clear();
+            board.get_group(x, y, chain);
+            double own = 0.0;
+            for (const auto& pos : chain) {
+                seen.set(pos.x, pos.y);
+                own += ownership->get(pos.x, pos.y);
+            }
+            own = (color == BLACK ? own : -own) / (double)chain.size();
+            if (alive[color - 1].test(x, y)) {
+                continue;
+            }
+            if (alive[get_opponent(color) - 1].test(x, y) || own <= -DEAD_OWNERSHIP) {
+                estimate.dead_stones.insert(estimate.dead_stones.end(), chain.begin(), chain.end());
+                scored.remove_group(x, y);
+            }
+        }
+    }
+    
+    auto score = RegionMap<SIZE>(scored).score();
+    estimate.black_score = score.first;
+    estimate.white_score = score.second;
+    double black_win_rate = ownership->get_black_win_rate();
+    estimate.confidence = score.first - score.second - komi > 0 ? black_win_rate : 1.0 - black_win_rate;
+    return estimate;
+}
+
+template <int SIZE>
+ScoreEstimate estimate_final_score(const Game<SIZE>& game, double komi, int playouts, uint64_t seed) {
+    return estimate_final_score(game.get_board(), game.get_current_player(), komi, playouts, seed);
+}
+
+template <int SIZE>
+OwnershipAnalysis analyze_ownership(const Board<SIZE>& board, int to_move, double komi, int playouts, int threads,
+                                    uint64_t seed) {
+    playouts = std::max(playouts, 0);
+    int thread_count = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+    thread_count = std::max(1, std::min(thread_count, playouts));
+    
+    auto share = [&](int t) { return playouts / thread_count + (t < playouts % thread_count ? 1 : 0); };
+    std::vector<PlayoutSums> parts(thread_count);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < thread_count; t++) {
+        uint64_t part_seed = seed + 0x9E3779B97F4A7C15ULL * (uint64_t)t;
+        workers.emplace_back(run_analysis_part<SIZE>, std::cref(board), to_move, komi, share(t), part_seed,
+                             std::ref(parts[t]));
+    }
+    run_analysis_part<SIZE>(board, to_move, komi, share(0), seed, parts[0]);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    OwnershipAnalysis analysis{std::vector<float>(SIZE * SIZE, 0.0f), 0.0, 0.0, 0.5, playouts};
+    if (playouts == 0) {
+        return analysis;
+    }
+    std::vector<int64_t> owner_sum(SIZE * SIZE, 0);
+    int black_wins = 0;
+    double score_sum = 0;
+    double score_square_sum = 0;
+    for (const auto& part : parts) {
+        for (int p = 0; p < SIZE * SIZE; p++) {
+            owner_sum[p] += part.owner_sum[p];
+        }
+        black_wins += part.black_wins;
+        score_sum += part.score_sum;
+        score_square_sum += part.score_square_sum;
+    }
+    for (int p = 0; p < SIZE * SIZE; p++) {
+        analysis.ownership[p] = (float)owner_sum[p] / playouts;
+    }
+    analysis.expected_score = score_sum / playouts;
+    analysis.score_variance = std::max(0.0, score_square_sum / playouts - analysis.expected_score * analysis.expected_score);
+    analysis.black_win_rate = (double)black_wins / playouts;
+    return analysis;
+}
+
+template <int SIZE>
+OwnershipAnalysis analyze_ownership(const Game<SIZE>& game, double komi, int playouts, int threads, uint64_t seed) {
+    return analyze_ownership(game.get_board(), game.get_current_player(), komi, playouts, threads, seed);
+}
+
+template class OwnershipMap<9>;
+template class OwnershipMap<13>;
+template class OwnershipMap<19>;
+template ScoreEstimate estimate_final_score<9>(const Board<9>& board, int to_move, double komi, int playouts,
+                                               uint64_t seed);
+template ScoreEstimate estimate_final_score<13>(const Board<13>& board, int to_move, double komi, int playouts,
+                                                uint64_t seed);
+template ScoreEstimate estimate_final_score<19>(const Board<19>& board, int to_move, double komi, int playouts,
+                                                uint64_t seed);
+template ScoreEstimate estimate_final_score<9>(const Game<9>& game, double komi, int playouts, uint64_t seed);
+template ScoreEstimate estimate_final_score<13>(const Game<13>& game, double komi, int playouts, uint64_t seed);
+template ScoreEstimate estimate_final_score<19>(const Game<19>& game, double komi, int playouts, uint64_t seed);
+template OwnershipAnalysis analyze_ownership<9>(const Board<9>& board, int to_move, double komi, int playouts,
+                                                int threads, uint64_t seed);
+template OwnershipAnalysis analyze_ownership<13>(const Board<13>& board, int to_move, double komi, int playouts,
+                                                 int threads, uint64_t seed);
+template OwnershipAnalysis analyze_ownership<19>(const Board<19>& board, int to_move, double komi, int playouts,
+                                                 int threads, uint64_t seed);
+template OwnershipAnalysis analyze_ownership<9>(const Game<9>& game, double komi, int playouts, int threads,
+                                                uint64_t seed);
+template OwnershipAnalysis analyze_ownership<13>(const Game<13>& game, double komi, int playouts, int threads,
+                                                 uint64_t seed);
+template OwnershipAnalysis analyze_ownership<19>(const Game<19>& game, double komi, int playouts, int threads,
+                                                 uint64_t seed);
@@ -0,0 +1,73 @@
+#ifndef OWNERSHIP_H
+#define OWNERSHIP_H
+
+#include "game.h"
+#include "playout.h"
+#include <vector>
+#include <cstdint>
+
+// Who ends up owning each point, averaged over random playouts from a
+// position: +1 is always black, -1 always white
+template <int SIZE>
+class OwnershipMap {
+private:
+    PlayoutEngine<SIZE> engine;
+    RegionMap<SIZE> regions;        // scores each finished playout
+    int owner_sum[SIZE * SIZE];     // black minus white final owners
+    int playouts;
+    int black_wins;
+
+public:
+    explicit OwnershipMap(uint64_t seed = 1);
+    
+    // Replaces the map with the outcome of playouts playouts from board;
+    // komi decides which of them black won
+    void estimate(const Board<SIZE>& board, int to_move, int playouts, double komi);
+    
+    double get(int x, int y) const;
+    double get_black_win_rate() const;
+    int get_playouts() const;
+};
+
+struct ScoreEstimate {
+    int black_score;                      // area score with the dead stones removed
+    int white_score;
+    double confidence;                    // share of playouts won by the side this score favors
+    std::vector<Position> dead_stones;
+};
+
+// Scores an unfinished game. Chains that Benson's algorithm finds
+// unconditionally alive always stay and chains in their eyes are always
+// dead; any other chain is dead when the playouts mostly give its stones
+// to the opponent. Dead chains come off whole before the area count. Costs
+// playouts random games, so a game can be scored long before it is played
+// out to the last dame.
+template <int SIZE>
+ScoreEstimate estimate_final_score(const Board<SIZE>& board, int to_move, double komi, int playouts,
+                                   uint64_t seed = 1);
+
+template <int SIZE>
+ScoreEstimate estimate_final_score(const Game<SIZE>& game, double komi, int playouts, uint64_t seed = 1);
+
+struct OwnershipAnalysis {
+    std::vector<float> ownership;         // y * size + x, from +1 always black's to -1 always white's
+    double expected_score;                // mean black minus white area score, komi included
+    double score_variance;
+    double black_win_rate;
+    int playouts;
+};
+
+// Ownership and score of a position in the middle of the game: playouts
+// random games split over threads threads (0 uses every hardware thread).
+// Each thread counts ownership in int16 sums, one flat add over the board
+// per playout, and the threads' counts are merged at the end. Same seed
+// and thread count, same result.
+template <int SIZE>
+OwnershipAnalysis analyze_ownership(const Board<SIZE>& board, int to_move, double komi, int playouts,
+                                    int threads = 0, uint64_t seed = 1);
+
+template <int SIZE>
+OwnershipAnalysis analyze_ownership(const Game<SIZE>& game, double komi, int playouts, int threads = 0,
+                                    uint64_t seed = 1);
+
+#endif // OWNERSHIP_H
@@ -0,0 +1,75 @@
+#include "pattern.h"
+
+namespace {
+
+// Where each neighbor slot (west, east, north, south, northwest, northeast,
+// southwest, southeast) goes under the eight symmetries of the square
+constexpr int SYMMETRY_SLOTS[8][8] = {
+    {0, 1, 2, 3, 4, 5, 6, 7},   // identity
+    {1, 0, 2, 3, 5, 4, 7, 6},   // mirror left-right
+    {0, 1, 3, 2, 6, 7, 4, 5},   // mirror top-bottom
+    {1, 0, 3, 2, 7, 6, 5, 4},   // rotate 180
+    {2, 3, 0, 1, 4, 6, 5, 7},   // transpose
+    {2, 3, 1, 0, 5, 7, 4, 6},   // rotate 90 one way
+    {3, 2, 0, 1, 6, 4, 7, 5},   // rotate 90 the other way
+    {3, 2, 1, 0, 7, 5, 6, 4}    // anti-transpose
+};
+
+uint32_t transform(uint32_t pattern, const int* slots) {
+    uint32_t result = 0;
+    for (int i = 0; i < 8; i++) {
+        result |= ((pattern >> (2 * i)) & 3) << (2 * slots[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        result |= ((pattern >> (PATTERN_ATARI_SHIFT + i)) & 1) << (PATTERN_ATARI_SHIFT + slots[i]);
+    }
+    return result;
+}
+
+float heuristic_weight(uint32_t pattern) {
+    bool capture = false;
+    bool save = false;
+    bool edge = false;
+    bool stones = false;
+    for (int i = 0; i < 8; i++) {
+        int cell = (pattern >> (2 * i)) & 3;
+        bool atari = i < 4 && (pattern >> (PATTERN_ATARI_SHIFT + i)) & 1;
+        capture |= cell == WHITE && atari;
+        save |= cell == BLACK && atari;
+        edge |= i < 4 && cell == OFFBOARD;
+        stones |= cell == BLACK || cell == WHITE;
+    }
+    
+    float weight = 1.0f;
+    if (capture) {
+        weight *= 20.0f;
+    }
+    if (save) {
+        weight *= 5.0f;
+    }
+    if (!stones) {
+        weight *= edge ? 0.2f : 0.5f;
+    }
+    return weight;
+}
+
+} // namespace
+
+PatternWeights::PatternWeights() : weights(size_t(1) << PATTERN_BITS, 1.0f) {}
+
+void PatternWeights::set(uint32_t pattern, float weight) {
+    for (const auto& slots : SYMMETRY_SLOTS) {
+        weights[transform(pattern, slots)] = weight;
+    }
+}
+
+const PatternWeights& PatternWeights::heuristic() {
+    static const PatternWeights table = [] {
+        PatternWeights weights;
+        for (uint32_t pattern = 0; pattern < (uint32_t(1) << PATTERN_BITS); pattern++) {
+            weights.weights[pattern] = heuristic_weight(pattern);
+        }
+        return weights;
+    }();
+    return table;
+}
@@ -0,0 +1,34 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include "board.h"
+#include <vector>
+#include <cstdint>
+
+// Move weights indexed by Board::get_pattern codes, so a policy scores a
+// candidate with one table load. Codes are read as if black were to move;
+// get() swaps the colors of the code for white.
+class PatternWeights {
+private:
+    std::vector<float> weights;
+
+public:
+    PatternWeights();
+    
+    float get(uint32_t pattern, int color) const {
+        if (color == WHITE) {
+            // Swap BLACK (01) and WHITE (10) in every 2-bit neighbor field
+            uint32_t ones = (pattern ^ (pattern >> 1)) & 0x5555;
+            pattern ^= ones | (ones << 1);
+        }
+        return weights[pattern];
+    }
+    // Sets the weight of a pattern and of its rotations and reflections
+    void set(uint32_t pattern, float weight);
+    
+    // Hand-written weights: capturing and saving chains in atari are
+    // favored, moves away from every stone and empty first-line moves are not
+    static const PatternWeights& heuristic();
+};
+
+#endif // PATTERN_H
@@ -0,0 +1,99 @@
+#include "playout.h"
+
+template <int SIZE>
+PlayoutEngine<SIZE>::PlayoutEngine(uint64_t seed) : random(seed) {
+    candidate_count = 0;
+    // Random games almost never last this long; the cap only stops
+    // superko cycles that simple ko does not catch
+    max_moves = 3 * SIZE * SIZE;
+    captured.reserve(SIZE * SIZE);
+}
+
+template <int SIZE>
+void PlayoutEngine<SIZE>::add_candidate(int point) {
+    candidate_index[point] = (int16_t)candidate_count;
+    candidates[candidate_count++] = (int16_t)point;
+}
+
+template <int SIZE>
+void PlayoutEngine<SIZE>::remove_candidate(int point) {
+    int index = candidate_index[point];
+    int last = candidates[--candidate_count];
+    candidates[index] = (int16_t)last;
+    candidate_index[last] = (int16_t)index;
+}
+
+template <int SIZE>
+bool PlayoutEngine<SIZE>::play_random_move(int color) {
+    // Draw candidates uniformly; a rejected one is swapped behind the
+    // range still being drawn from, so every legal move stays equally likely
+    int remaining = candidate_count;
+    while (remaining > 0) {
+        int index = (int)random.below((uint32_t)remaining);
+        int point = candidates[index];
+        int x = point % SIZE;
+        int y = point / SIZE;
+        
+        if (board.is_valid_move(x, y, color) && !board.is_eye(x, y, color)) {
+            captured.clear();
+            board.make_move(x, y, color, &captured);
+            remove_candidate(point);
+            for (const auto& pos : captured) {
+                add_candidate(pos.y * SIZE + pos.x);
+            }
+            return true;
+        }
+        
+        remaining--;
+        int other = candidates[remaining];
+        candidates[index] = (int16_t)other;
+        candidates[remaining] = (int16_t)point;
+        candidate_index[other] = (int16_t)index;
+        candidate_index[point] = (int16_t)remaining;
+    }
+    return false;
+}
+
+template <int SIZE>
+PlayoutResult PlayoutEngine<SIZE>::run(const Board<SIZE>& start, int to_move) {
+    board = start;
+    candidate_count = 0;
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            if (board.get(x, y) == EMPTY) {
+                add_candidate(y * SIZE + x);
+            }
+        }
+    }
+    
+    int color = to_move;
+    int passes = 0;
+    int moves = 0;
+    while (passes < 2 && moves < max_moves) {
+        if (play_random_move(color)) {
+            passes = 0;
+            moves++;
+        } else {
+            passes++;
+        }
+        color = get_opponent(color);
+    }
+    
+    regions.rebuild(board);
+    auto score = regions.score();
+    return PlayoutResult{score.first, score.second, moves};
+}
+
+template <int SIZE>
+PlayoutResult PlayoutEngine<SIZE>::run(const Game<SIZE>& game) {
+    return run(game.get_board(), game.get_current_player());
+}
+
+template <int SIZE>
+const Board<SIZE>& PlayoutEngine<SIZE>::get_board() const {
+    return board;
+}
+
+template class PlayoutEngine<9>;
+template class PlayoutEngine<13>;
+template class PlayoutEngine<19>;
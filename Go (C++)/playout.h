@@ -0,0 +1,68 @@
+#ifndef PLAYOUT_H
+#define PLAYOUT_H
+
+#include "board.h"
+#include "game.h"
+#include "score.h"
+#include <vector>
+#include <cstdint>
+
+// xorshift64* generator: a few cycles per number, good enough for playouts
+class FastRandom {
+private:
+    uint64_t state;
+
+public:
+    explicit FastRandom(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+    
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+    
+    // Uniform in [0, n) without a division
+    uint32_t below(uint32_t n) {
+        return (uint32_t)(((next() >> 32) * n) >> 32);
+    }
+};
+
+struct PlayoutResult {
+    int black_score;   // area score of the final position, as calculate_score
+    int white_score;
+    int moves;         // stones played, passes not counted
+};
+
+// Plays random games to the end: both sides play uniformly random legal
+// moves that do not fill their own eyes, until two passes in a row. All
+// scratch state is allocated once; the candidate list is kept in sync with
+// each move's captures instead of calling get_valid_moves every ply.
+template <int SIZE>
+class PlayoutEngine {
+private:
+    Board<SIZE> board;
+    FastRandom random;
+    int16_t candidates[SIZE * SIZE];        // empty points, y * SIZE + x
+    int16_t candidate_index[SIZE * SIZE];
+    int candidate_count;
+    std::vector<Position> captured;
+    RegionMap<SIZE> regions;                // scores the final position
+    int max_moves;
+    
+    void add_candidate(int point);
+    void remove_candidate(int point);
+    bool play_random_move(int color);
+
+public:
+    explicit PlayoutEngine(uint64_t seed = 1);
+    
+    PlayoutResult run(const Board<SIZE>& start, int to_move);
+    PlayoutResult run(const Game<SIZE>& game);
+    
+    // Final position of the last playout
+    const Board<SIZE>& get_board() const;
+};
+
+#endif // PLAYOUT_H
+
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include "playout.h"
+
+template <int SIZE>
+void run_benchmark(double seconds) {
+    PlayoutEngine<SIZE> engine(12345);
+    Board<SIZE> empty;
+    long long playouts = 0;
+    long long moves = 0;
+    long long black_wins = 0;
+    
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < seconds) {
+        // Check the clock every few playouts to keep timing overhead out
+        for (int i = 0; i < 16; i++) {
+            PlayoutResult result = engine.run(empty, BLACK);
+            playouts++;
+            moves += result.moves;
+            if (result.black_score > result.white_score) {
+                black_wins++;
+            }
+        }
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    std::cout << SIZE << "x" << SIZE << " empty board: "
+              << playouts << " playouts in " << elapsed << " s" << std::endl;
+    std::cout << "  playouts/s: " << (long long)(playouts / elapsed) << std::endl;
+    std::cout << "  moves/s:    " << (long long)(moves / elapsed) << std::endl;
+    std::cout << "  avg moves:  " << (double)moves / playouts << std::endl;
+    std::cout << "  black wins: " << 100.0 * black_wins / playouts << "%" << std::endl;
+}
+
+// Headless benchmark: random playouts from an empty board for a fixed time,
+// reporting playouts/second and moves/second.
+//
+// Usage: GoPlayoutBench [seconds] [board_size]
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 5.0;
+    int size = argc > 2 ? std::atoi(argv[2]) : DEFAULT_BOARD_SIZE;
+    if (seconds <= 0 || !is_supported_board_size(size)) {
+        std::cerr << "Usage: GoPlayoutBench [seconds] [board_size: 9, 13 or 19]" << std::endl;
+        return 1;
+    }
+    
+    dispatch_board_size(size, [&](auto board_size) {
+        run_benchmark<decltype(board_size)::value>(seconds);
+    });
+    return 0;
+}
+
@@ -0,0 +1,150 @@
+#include "replay.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+struct GameSpan {
+    const char* begin;
+    const char* end;
+    int file;
+    int game;
+};
+
+struct WorkerResult {
+    int legal;
+    long long moves;
+    std::vector<ReplayFailure> failures;
+};
+
+// One Game per board size, reused for every game a worker replays
+using ReplayGames = std::tuple<Game<9>, Game<13>, Game<19>>;
+
+void run_worker(const std::vector<GameSpan>& spans, std::atomic<size_t>& next_span, WorkerResult& result) {
+    result = WorkerResult{0, 0, {}};
+    std::unique_ptr<ReplayGames> games(new ReplayGames());
+    SgfGame sgf;
+    for (;;) {
+        size_t index = next_span.fetch_add(1, std::memory_order_relaxed);
+        if (index >= spans.size()) {
+            break;
+        }
+        const GameSpan& span = spans[index];
+        SgfReader reader(span.begin, (size_t)(span.end - span.begin));
+        if (!reader.next(sgf)) {
+            result.failures.push_back(ReplayFailure{span.file, span.game, ReplayStatus::ParseError, 0, reader.get_error()});
+            continue;
+        }
+        if (!is_supported_board_size(sgf.board_size)) {
+            result.failures.push_back(ReplayFailure{span.file, span.game, ReplayStatus::Unsupported, 0, ""});
+            continue;
+        }
+        
+        ReplayOutcome outcome = dispatch_board_size(sgf.board_size, [&](auto board_size) {
+            return replay_game(sgf, std::get<Game<decltype(board_size)::value>>(*games));
+        });
+        result.moves += outcome.moves;
+        if (outcome.status == ReplayStatus::Legal) {
+            result.legal++;
+        } else {
+            result.failures.push_back(ReplayFailure{span.file, span.game, outcome.status, outcome.moves + 1, ""});
+        }
+    }
+}
+
+} // namespace
+
+template <int SIZE>
+ReplayOutcome replay_game(const SgfGame& sgf, Game<SIZE>& game, std::vector<uint64_t>* hashes) {
+    ReplayOutcome outcome{ReplayStatus::Legal, 0, 0, 0};
+    if (sgf.board_size != SIZE || sgf.later_setup) {
+        outcome.status = ReplayStatus::Unsupported;
+        return outcome;
+    }
+    for (const auto* stones : {&sgf.black_setup, &sgf.white_setup}) {
+        for (const auto& pos : *stones) {
+            if ((unsigned)pos.x >= (unsigned)SIZE || (unsigned)pos.y >= (unsigned)SIZE) {
+                outcome.status = ReplayStatus::Illegal;
+                return outcome;
+            }
+        }
+    }
+    
+    game.setup(sgf.black_setup, sgf.white_setup, sgf.first_player);
+    for (const auto& move : sgf.moves) {
+        if (move.color != game.get_current_player() || !game.make_move(move.point.x, move.point.y)) {
+            outcome.status = ReplayStatus::Illegal;
+            break;
+        }
+        outcome.moves++;
+        if (hashes) {
+            hashes->push_back(game.get_board().get_hash());
+        }
+    }
+    
+    auto score = game.calculate_score();
+    outcome.black_score = score.first;
+    outcome.white_score = score.second;
+    return outcome;
+}
+
+ReplayReport replay_files(const std::vector<std::string>& paths, int threads) {
+    ReplayReport report{(int)paths.size(), 0, 0, 0, 0.0, {}};
+    auto start = std::chrono::steady_clock::now();
+    
+    // Cut every file into game trees first. The bracket scan reads each
+    // byte once and decodes nothing, so it is a small part of the work.
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<GameSpan> spans;
+    for (int f = 0; f < (int)paths.size(); f++) {
+        files.emplace_back(new MappedFile());
+        if (!files.back()->open(paths[f])) {
+            report.failures.push_back(ReplayFailure{f, -1, ReplayStatus::ParseError, 0, "cannot read " + paths[f]});
+            continue;
+        }
+        SgfReader reader(files.back()->data(), files.back()->size());
+        const char* begin;
+        const char* end;
+        int game = 0;
+        while (reader.next_span(begin, end)) {
+            spans.push_back(GameSpan{begin, end, f, game++});
+        }
+        if (!reader.get_error().empty()) {
+            report.failures.push_back(ReplayFailure{f, game, ReplayStatus::ParseError, 0, reader.get_error()});
+        }
+    }
+    
+    int thread_count = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+    thread_count = std::max(1, std::min(thread_count, (int)std::max(spans.size(), (size_t)1)));
+    std::atomic<size_t> next_span(0);
+    std::vector<WorkerResult> results(thread_count);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; i++) {
+        workers.emplace_back(run_worker, std::cref(spans), std::ref(next_span), std::ref(results[i]));
+    }
+    run_worker(spans, next_span, results[0]);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    report.games = (int)spans.size();
+    for (auto& result : results) {
+        report.legal += result.legal;
+        report.moves += result.moves;
+        report.failures.insert(report.failures.end(), result.failures.begin(), result.failures.end());
+    }
+    std::sort(report.failures.begin(), report.failures.end(), [](const ReplayFailure& a, const ReplayFailure& b) {
+        return a.file != b.file ? a.file < b.file : a.game < b.game;
+    });
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+template ReplayOutcome replay_game<9>(const SgfGame& sgf, Game<9>& game, std::vector<uint64_t>* hashes);
+template ReplayOutcome replay_game<13>(const SgfGame& sgf, Game<13>& game, std::vector<uint64_t>* hashes);
+template ReplayOutcome replay_game<19>(const SgfGame& sgf, Game<19>& game, std::vector<uint64_t>* hashes);
@@ -0,0 +1,52 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+#include "sgf.h"
+#include <string>
+#include <vector>
+
+enum class ReplayStatus {
+    Legal,
+    Illegal,       // a move was rejected, or played out of turn
+    Unsupported,   // board size, or setup stones after the first move
+    ParseError
+};
+
+struct ReplayOutcome {
+    ReplayStatus status;
+    int moves;                 // moves played, up to the first rejected one
+    int black_score;           // area score of the last position reached
+    int white_score;
+};
+
+// Plays the main line of sgf through game.make_move, starting from the
+// root's setup stones. game is reset first, so one Game can replay many.
+// The board hash after each move is appended to hashes when it is given.
+template <int SIZE>
+ReplayOutcome replay_game(const SgfGame& sgf, Game<SIZE>& game, std::vector<uint64_t>* hashes = nullptr);
+
+struct ReplayFailure {
+    int file;                  // index into the list of paths
+    int game;                  // game tree number within that file
+    ReplayStatus status;
+    int move;                  // 1-based move that failed, for Illegal
+    std::string message;       // file or parse error text
+};
+
+struct ReplayReport {
+    int files;
+    int games;
+    int legal;
+    long long moves;
+    double seconds;
+    std::vector<ReplayFailure> failures;
+};
+
+// Replays every game of every file on a pool of threads. Each file is
+// memory-mapped and cut into game trees by a quick bracket scan; threads
+// then take trees from all files off a shared counter, so one huge file
+// parallelizes as well as many small ones.
+ReplayReport replay_files(const std::vector<std::string>& paths, int threads);
+
+#endif // REPLAY_H
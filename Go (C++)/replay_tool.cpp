@@ -0,0 +1,79 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "replay.h"
+
+namespace {
+
+const char* status_name(ReplayStatus status) {
+    switch (status) {
+    case ReplayStatus::Legal:
+        return "legal";
+    case ReplayStatus::Illegal:
+        return "illegal move";
+    case ReplayStatus::Unsupported:
+        return "unsupported";
+    case ReplayStatus::ParseError:
+        return "parse error";
+    }
+    return "";
+}
+
+} // namespace
+
+// Headless bulk replay: reads every game in the given SGF files, plays the
+// main lines through the rules engine to check every move, scores the final
+// positions and reports replayed moves/second.
+//
+// Usage: GoReplay [--threads N] [--verbose] FILE...
+int main(int argc, char** argv) {
+    int threads = 0;
+    bool verbose = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty() || threads < 0) {
+        std::cerr << "Usage: GoReplay [--threads N] [--verbose] FILE..." << std::endl;
+        return 1;
+    }
+    
+    ReplayReport report = replay_files(paths, threads);
+    
+    int counts[4] = {0, 0, 0, 0};
+    for (const auto& failure : report.failures) {
+        counts[(int)failure.status]++;
+        if (verbose || !failure.message.empty()) {
+            std::cerr << paths[failure.file];
+            if (failure.game >= 0) {
+                std::cerr << " game " << failure.game + 1;
+            }
+            std::cerr << ": " << status_name(failure.status);
+            if (failure.status == ReplayStatus::Illegal) {
+                std::cerr << " at move " << failure.move;
+            }
+            if (!failure.message.empty()) {
+                std::cerr << " (" << failure.message << ")";
+            }
+            std::cerr << std::endl;
+        }
+    }
+    
+    double seconds = report.seconds > 0 ? report.seconds : 1e-9;
+    std::cout << report.files << " files, " << report.games << " games: " << report.legal << " legal, "
+              << counts[(int)ReplayStatus::Illegal] << " with an illegal move, "
+              << counts[(int)ReplayStatus::Unsupported] << " unsupported, "
+              << counts[(int)ReplayStatus::ParseError] << " parse errors" << std::endl;
+    std::cout << report.moves << " moves in " << report.seconds << " s: "
+              << (long long)(report.moves / seconds) << " moves/s, "
+              << (long long)(report.games / seconds) << " games/s" << std::endl;
+    return report.failures.empty() ? 0 : 2;
+}
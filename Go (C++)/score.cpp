@@ -0,0 +1,316 @@
+#include "score.h"
+#include <algorithm>
+
+int Region::owner() const {
+    if (borders_black && !borders_white) {
+        return BLACK;
+    } else if (borders_white && !borders_black) {
+        return WHITE;
+    } else {
+        return EMPTY;
+    }
+}
+
+template <int SIZE>
+RegionMap<SIZE>::RegionMap() {
+    rebuild(Board<SIZE>());
+}
+
+template <int SIZE>
+RegionMap<SIZE>::RegionMap(const Board<SIZE>& board) {
+    rebuild(board);
+}
+
+template <int SIZE>
+int RegionMap<SIZE>::allocate_region() {
+    if (!free_ids.empty()) {
+        int id = free_ids.back();
+        free_ids.pop_back();
+        return id;
+    }
+    regions.push_back(Region{0, false, false});
+    return (int)regions.size() - 1;
+}
+
+template <int SIZE>
+void RegionMap<SIZE>::release_region(int id) {
+    Region& r = regions[id];
+    if (r.size == 0) {
+        return; // Already released
+    }
+    int owner = r.owner();
+    if (owner != EMPTY) {
+        territory[owner - 1] -= r.size;
+    }
+    r = Region{0, false, false};
+    free_ids.push_back(id);
+}
+
+template <int SIZE>
+void RegionMap<SIZE>::flood(const Board<SIZE>& board, int start) {
+    // Labels the empty region containing start with a fresh id
+    int id = allocate_region();
+    Region& r = regions[id];
+    r = Region{0, false, false};
+    
+    int stack[POINTS];
+    int top = 0;
+    stack[top++] = start;
+    visited[start] = visit_stamp;
+    
+    while (top > 0) {
+        int p = stack[--top];
+        labels[p] = (int16_t)id;
+        r.size++;
+        
+        int x = p % SIZE;
+        int y = p / SIZE;
+        const int nx[4] = {x - 1, x + 1, x, x};
+        const int ny[4] = {y, y, y - 1, y + 1};
+        for (int i = 0; i < 4; i++) {
+            int cell = board.get(nx[i], ny[i]);
+            if (cell == BLACK) {
+                r.borders_black = true;
+            } else if (cell == WHITE) {
+                r.borders_white = true;
+            } else if (cell == EMPTY) {
+                int n = ny[i] * SIZE + nx[i];
+                if (visited[n] != visit_stamp) {
+                    visited[n] = visit_stamp;
+                    stack[top++] = n;
+                }
+            }
+        }
+    }
+    
+    int owner = r.owner();
+    if (owner != EMPTY) {
+        territory[owner - 1] += r.size;
+    }
+}
+
+template <int SIZE>
+void RegionMap<SIZE>::rebuild(const Board<SIZE>& board) {
+    regions.clear();
+    free_ids.clear();
+    stones[0] = stones[1] = 0;
+    territory[0] = territory[1] = 0;
+    visit_stamp = 1;
+    for (int p = 0; p < POINTS; p++) {
+        visited[p] = 0;
+    }
+    
+    // One sweep: every empty point is reached by exactly one flood fill
+    for (int p = 0; p < POINTS; p++) {
+        int cell = board.get(p % SIZE, p / SIZE);
+        colors[p] = (uint8_t)cell;
+        if (cell == EMPTY) {
+            if (visited[p] != visit_stamp) {
+                flood(board, p);
+            }
+        } else {
+            labels[p] = -1;
+            stones[cell - 1]++;
+        }
+    }
+}
+
+template <int SIZE>
+void RegionMap<SIZE>::update(const Board<SIZE>& board, const std::vector<Position>& changed) {
+    visit_stamp++;
+    
+    // Every region touching a changed point is relabeled from scratch. Each
+    // new region contains a changed point or one of its neighbors, so
+    // flooding from those covers every point of the released regions.
+    for (const auto& pos : changed) {
+        int p = pos.y * SIZE + pos.x;
+        const int nx[5] = {pos.x, pos.x - 1, pos.x + 1, pos.x, pos.x};
+        const int ny[5] = {pos.y, pos.y, pos.y, pos.y - 1, pos.y + 1};
+        for (int i = 0; i < 5; i++) {
+            if (board.get(nx[i], ny[i]) != -1) {
+                int n = ny[i] * SIZE + nx[i];
+                if (labels[n] >= 0) {
+                    release_region(labels[n]);
+                }
+            }
+        }
+        
+        int cell = board.get(pos.x, pos.y);
+        if (colors[p] != EMPTY) {
+            stones[colors[p] - 1]--;
+        }
+        if (cell != EMPTY) {
+            stones[cell - 1]++;
+        }
+        colors[p] = (uint8_t)cell;
+        labels[p] = -1;
+    }
+    
+    for (const auto& pos : changed) {
+        const int nx[5] = {pos.x, pos.x - 1, pos.x + 1, pos.x, pos.x};
+        const int ny[5] = {pos.y, pos.y, pos.y, pos.y - 1, pos.y + 1};
+        for (int i = 0; i < 5; i++) {
+            if (board.get(nx[i], ny[i]) == EMPTY) {
+                int n = ny[i] * SIZE + nx[i];
+                if (visited[n] != visit_stamp) {
+                    flood(board, n);
+                }
+            }
+        }
+    }
+}
+
+template <int SIZE>
+int RegionMap<SIZE>::get_region(int x, int y) const {
+    if ((unsigned)x >= (unsigned)SIZE || (unsigned)y >= (unsigned)SIZE) {
+        return -1;
+    }
+    return labels[y * SIZE + x];
+}
+
+template <int SIZE>
+const Region& RegionMap<SIZE>::region(int id) const {
+    return regions[id];
+}
+
+template <int SIZE>
+int RegionMap<SIZE>::get_owner(int x, int y) const {
+    int id = get_region(x, y);
+    return id < 0 ? EMPTY : regions[id].owner();
+}
+
+template <int SIZE>
+std::pair<int, int> RegionMap<SIZE>::score() const {
+    return std::make_pair(stones[0] + territory[0], stones[1] + territory[1]);
+}
+
+template <int SIZE>
+Bitboard<SIZE> find_unconditional_life(const Board<SIZE>& board, int color) {
+    constexpr int POINTS = SIZE * SIZE;
+    // Chains of color and the regions between them (empty points and
+    // opponent stones alike), each labeled by flood fill
+    int16_t chain_of[POINTS];
+    int16_t region_of[POINTS];
+    std::fill(chain_of, chain_of + POINTS, (int16_t)-1);
+    std::fill(region_of, region_of + POINTS, (int16_t)-1);
+    int chain_count = 0;
+    int region_count = 0;
+    int stack[POINTS];
+    for (int start = 0; start < POINTS; start++) {
+        if (chain_of[start] >= 0 || region_of[start] >= 0) {
+            continue;
+        }
+        bool is_chain = board.get(start % SIZE, start / SIZE) == color;
+        int16_t* labels = is_chain ? chain_of : region_of;
+        int16_t id = (int16_t)(is_chain ? chain_count++ : region_count++);
+        int top = 0;
+        stack[top++] = start;
+        labels[start] = id;
+        while (top > 0) {
+            int p = stack[--top];
+            int x = p % SIZE;
+            int y = p / SIZE;
+            const int nx[4] = {x - 1, x + 1, x, x};
+            const int ny[4] = {y, y, y - 1, y + 1};
+            for (int i = 0; i < 4; i++) {
+                int cell = board.get(nx[i], ny[i]);
+                int n = ny[i] * SIZE + nx[i];
+                if (cell >= 0 && (cell == color) == is_chain && labels[n] < 0) {
+                    labels[n] = id;
+                    stack[top++] = n;
+                }
+            }
+        }
+    }
+    
+    // The chains bordering each region, and those it is vital to: the
+    // chains next to every one of its empty points
+    std::vector<std::vector<int>> borders(region_count);
+    std::vector<std::vector<int>> vital(region_count);
+    std::vector<bool> seen_empty(region_count, false);
+    for (int p = 0; p < POINTS; p++) {
+        int r = region_of[p];
+        if (r < 0) {
+            continue;
+        }
+        int x = p % SIZE;
+        int y = p / SIZE;
+        const int nx[4] = {x - 1, x + 1, x, x};
+        const int ny[4] = {y, y, y - 1, y + 1};
+        std::vector<int> adjacent;
+        for (int i = 0; i < 4; i++) {
+            if (board.get(nx[i], ny[i]) == color) {
+                int c = chain_of[ny[i] * SIZE + nx[i]];
+                adjacent.push_back(c);
+                if (std::find(borders[r].begin(), borders[r].end(), c) == borders[r].end()) {
+                    borders[r].push_back(c);
+                }
+            }
+        }
+        if (board.get(x, y) == EMPTY) {
+            if (!seen_empty[r]) {
+                seen_empty[r] = true;
+                vital[r] = adjacent;
+            } else {
+                vital[r].erase(std::remove_if(vital[r].begin(), vital[r].end(), [&](int c) {
+                    return std::find(adjacent.begin(), adjacent.end(), c) == adjacent.end();
+                }), vital[r].end());
+            }
+        }
+    }
+    for (int r = 0; r < region_count; r++) {
+        std::sort(vital[r].begin(), vital[r].end());
+        vital[r].erase(std::unique(vital[r].begin(), vital[r].end()), vital[r].end());
+    }
+    
+    // Drop chains with fewer than two vital regions, then regions bordered
+    // by a dropped chain, until both sets stop shrinking
+    std::vector<bool> chain_alive(chain_count, true);
+    std::vector<bool> region_alive(region_count, true);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::vector<int> eyes(chain_count, 0);
+        for (int r = 0; r < region_count; r++) {
+            if (region_alive[r]) {
+                for (int c : vital[r]) {
+                    eyes[c]++;
+                }
+            }
+        }
+        for (int c = 0; c < chain_count; c++) {
+            if (chain_alive[c] && eyes[c] < 2) {
+                chain_alive[c] = false;
+                changed = true;
+            }
+        }
+        for (int r = 0; r < region_count; r++) {
+            if (region_alive[r]) {
+                for (int c : borders[r]) {
+                    if (!chain_alive[c]) {
+                        region_alive[r] = false;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    
+    Bitboard<SIZE> alive;
+    for (int p = 0; p < POINTS; p++) {
+        bool chain = chain_of[p] >= 0 && chain_alive[chain_of[p]];
+        bool eye = region_of[p] >= 0 && region_alive[region_of[p]] && !vital[region_of[p]].empty();
+        if (chain || eye) {
+            alive.set(p % SIZE, p / SIZE);
+        }
+    }
+    return alive;
+}
+
+template class RegionMap<9>;
+template class RegionMap<13>;
+template class RegionMap<19>;
+template Bitboard<9> find_unconditional_life<9>(const Board<9>& board, int color);
+template Bitboard<13> find_unconditional_life<13>(const Board<13>& board, int color);
+template Bitboard<19> find_unconditional_life<19>(const Board<19>& board, int color);
@@ -0,0 +1,63 @@
+#ifndef SCORE_H
+#define SCORE_H
+
+#include "board.h"
+#include <vector>
+#include <utility>
+
+// One connected region of empty points and the colors on its border
+struct Region {
+    int size;
+    bool borders_black;
+    bool borders_white;
+    
+    int owner() const; // BLACK, WHITE, or EMPTY if neutral
+};
+
+// Labels every empty region of a board in a single sweep, so the area score,
+// each region's owner and the territory map all come from one pass instead
+// of a flood fill per empty point. update() keeps the labels current as
+// moves are played by relabeling only the regions next to changed points.
+template <int SIZE>
+class RegionMap {
+private:
+    static constexpr int POINTS = SIZE * SIZE;
+    
+    int16_t labels[POINTS];        // region id of each empty point, -1 on stones
+    uint8_t colors[POINTS];        // board contents at the last update
+    uint32_t visited[POINTS];      // flood-fill marks, compared against visit_stamp
+    uint32_t visit_stamp;
+    std::vector<Region> regions;
+    std::vector<int> free_ids;     // ids of regions that no longer exist
+    int stones[2];
+    int territory[2];
+    
+    int allocate_region();
+    void release_region(int id);
+    void flood(const Board<SIZE>& board, int start);
+
+public:
+    RegionMap();
+    explicit RegionMap(const Board<SIZE>& board);
+    
+    void rebuild(const Board<SIZE>& board);
+    // Points in changed went from empty to a stone or back (placed, captured
+    // or undone) since the map last saw the board
+    void update(const Board<SIZE>& board, const std::vector<Position>& changed);
+    
+    int get_region(int x, int y) const; // -1 on stones
+    const Region& region(int id) const;
+    int get_owner(int x, int y) const;  // BLACK, WHITE, or EMPTY if neutral
+    std::pair<int, int> score() const;  // Area score: (black_score, white_score)
+};
+
+// Benson's algorithm: the chains of color that stay on the board whatever
+// the opponent plays, even if color passes every turn, together with the
+// enclosed regions that give them their eyes (opponent stones inside those
+// are dead). Only a chain with two or more regions all of whose empty
+// points are its liberties survives, iterated until nothing changes.
+template <int SIZE>
+Bitboard<SIZE> find_unconditional_life(const Board<SIZE>& board, int color);
+
+#endif // SCORE_H
+
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <cstdlib>
+#include <thread>
+#include "mcts.h"
+
+template <int SIZE>
+void run_benchmark(double seconds, int max_threads) {
+    std::cout << SIZE << "x" << SIZE << " empty board" << std::endl;
+    Game<SIZE> game;
+    double single_rate = 0;
+    for (int threads = 1; ; threads *= 2) {
+        threads = std::min(threads, max_threads);
+        
+        SearchConfig config;
+        config.threads = threads;
+        config.seconds = seconds;
+        config.seed = 12345;
+        SearchResult result = MctsSearch<SIZE>(config).search(game);
+        
+        double rate = result.playouts / result.seconds;
+        if (threads == 1) {
+            single_rate = rate;
+        }
+        std::cout << threads << " thread(s): " << result.playouts << " playouts, "
+                  << (long long)rate << " playouts/s, speedup " << rate / single_rate
+                  << ", best " << result.best_move.x << "," << result.best_move.y << std::endl;
+        for (size_t i = 0; i < result.threads.size(); i++) {
+            std::cout << "  thread " << i << ": " << result.threads[i].playouts << " playouts, "
+                      << (long long)result.threads[i].nodes_per_second << " nodes/s" << std::endl;
+        }
+        
+        if (threads >= max_threads) {
+            break;
+        }
+    }
+    
+    SearchConfig config;
+    config.threads = max_threads;
+    config.seconds = seconds;
+    config.seed = 12345;
+    MctsSearch<SIZE> search(config);
+    for (int move = 0; move < 6 && !game.is_game_over(); move++) {
+        SearchResult result = search.search(game);
+        std::cout << "move " << move + 1 << ": reused " << result.reused_nodes << " nodes, tree "
+                  << result.tree_nodes << " nodes, best " << result.best_move.x << ","
+                  << result.best_move.y << std::endl;
+        std::cout << "  transpositions: " << result.transpositions.hits << " hits, "
+                  << result.transpositions.misses << " misses, "
+                  << result.transpositions.collisions << " collisions" << std::endl;
+        game.make_move(result.best_move.x, result.best_move.y);
+    }
+}
+
+// Headless benchmark: tree search from the empty board with 1, 2, 4, ...
+// threads, reporting nodes/second per thread and the speedup over one thread,
+// then a few moves of self-play showing how much of the tree each search
+// inherits from the one before.
+//
+// Usage: GoSearchBench [seconds] [max_threads] [board_size]
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    int max_threads = argc > 2 ? std::atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    int size = argc > 3 ? std::atoi(argv[3]) : DEFAULT_BOARD_SIZE;
+    if (seconds <= 0 || max_threads <= 0 || !is_supported_board_size(size)) {
+        std::cerr << "Usage: GoSearchBench [seconds] [max_threads] [board_size: 9, 13 or 19]" << std::endl;
+        return 1;
+    }
+    
+    dispatch_board_size(size, [&](auto board_size) {
+        run_benchmark<decltype(board_size)::value>(seconds, max_threads);
+    });
+    return 0;
+}
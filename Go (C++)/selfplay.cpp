@@ -0,0 +1,265 @@
+#include "selfplay.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// splitmix64 of the batch seed and game number: neighboring games get
+// unrelated seeds, and a game's seed does not depend on which thread plays it
+uint64_t game_seed(uint64_t seed, uint32_t index) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL * ((uint64_t)index + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+bool pin_current_thread(int cpu) {
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (cpu % 64)) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CPU_SETSIZE, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+struct WorkerResult {
+    SelfPlayWorkerStats stats;
+    int black_wins;
+    int resolved;
+};
+
+template <int SIZE>
+std::unique_ptr<MovePolicy<SIZE>> make_policy(const SelfPlayConfig& config) {
+    if (config.policy == PolicyKind::Search) {
+        SearchConfig search;
+        search.threads = 1;
+        search.seconds = 0;
+        search.max_playouts = config.playouts;
+        search.komi = config.komi;
+        // Each worker runs its own search, and at a few thousand playouts a
+        // move the transposition table costs more than it saves
+        search.table_megabytes = 0;
+        return std::unique_ptr<MovePolicy<SIZE>>(new SearchPolicy<SIZE>(search));
+    }
+    if (config.policy == PolicyKind::Pattern) {
+        return std::unique_ptr<MovePolicy<SIZE>>(new PatternPolicy<SIZE>());
+    }
+    return std::unique_ptr<MovePolicy<SIZE>>(new RandomPolicy<SIZE>());
+}
+
+template <int SIZE>
+GameRecord play_game(Game<SIZE>& game, MovePolicy<SIZE>& policy, const SelfPlayConfig& config,
+                     uint32_t index) {
+    uint64_t seed = game_seed(config.seed, index);
+    GameRecord record{};
+    record.index = index;
+    record.seed = seed;
+    record.board_size = SIZE;
+    record.komi = config.komi;
+    int max_moves = config.max_moves > 0 ? config.max_moves : 3 * SIZE * SIZE;
+    
+    game.reset();
+    policy.start_game(seed);
+    while (!game.is_game_over()) {
+        if ((int)record.moves.size() >= max_moves) {
+            record.move_limit = true;
+            break;
+        }
+        int played = (int)record.moves.size();
+        if (config.resolve_confidence > 0 && played >= SIZE * SIZE / 2 && played % SIZE == 0) {
+            ScoreEstimate estimate = estimate_final_score(game, config.komi, config.resolve_playouts, seed + played);
+            if (estimate.confidence >= config.resolve_confidence) {
+                record.black_score = estimate.black_score;
+                record.white_score = estimate.white_score;
+                record.score_estimated = true;
+                return record;
+            }
+        }
+        Position move = policy.choose_move(game);
+        if (move.x < 0 || !game.make_move(move.x, move.y)) {
+            // A policy that offers an illegal move passes instead
+            move = Position(-1, -1);
+            game.make_move(-1, -1);
+        }
+        record.moves.push_back(move.x < 0 ? (int16_t)-1 : (int16_t)(move.y * SIZE + move.x));
+    }
+    
+    auto score = game.calculate_score();
+    record.black_score = score.first;
+    record.white_score = score.second;
+    return record;
+}
+
+template <int SIZE>
+void run_worker(const SelfPlayConfig& config, int worker, std::atomic<int>& next_game,
+                GameRecordWriter* records, std::mutex& records_mutex, WorkerResult& result) {
+    result = WorkerResult{SelfPlayWorkerStats{0, 0, 0.0, false}, 0, 0};
+    if (config.pin_threads) {
+        result.stats.pinned = pin_current_thread(worker % std::max(1u, std::thread::hardware_concurrency()));
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    Game<SIZE> game;
+    std::unique_ptr<MovePolicy<SIZE>> policy = make_policy<SIZE>(config);
+    for (;;) {
+        int index = next_game.fetch_add(1, std::memory_order_relaxed);
+        if (index >= config.games) {
+            break;
+        }
+        GameRecord record = play_game(game, *policy, config, (uint32_t)index);
+        result.stats.games++;
+        result.stats.moves += (long long)record.moves.size();
+        if (record.black_score - record.white_score - config.komi > 0) {
+            result.black_wins++;
+        }
+        if (record.score_estimated) {
+            result.resolved++;
+        }
+        if (records) {
+            std::lock_guard<std::mutex> lock(records_mutex);
+            records->write(record);
+        }
+    }
+    result.stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <int SIZE>
+SelfPlayReport run_batch(const SelfPlayConfig& config, GameRecordWriter* records) {
+    int thread_count = config.threads > 0 ? config.threads : (int)std::thread::hardware_concurrency();
+    thread_count = std::max(1, std::min(thread_count, std::max(config.games, 1)));
+    
+    std::atomic<int> next_game(0);
+    std::mutex records_mutex;
+    std::vector<WorkerResult> results(thread_count);
+    
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 1; i < thread_count; i++) {
+        threads.emplace_back(run_worker<SIZE>, std::cref(config), i, std::ref(next_game), records,
+                             std::ref(records_mutex), std::ref(results[i]));
+    }
+    run_worker<SIZE>(config, 0, next_game, records, records_mutex, results[0]);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    SelfPlayReport report{0, 0, 0, 0, 0, 0.0, {}};
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& result : results) {
+        report.games += result.stats.games;
+        report.moves += result.stats.moves;
+        report.black_wins += result.black_wins;
+        report.resolved += result.resolved;
+        report.workers.push_back(result.stats);
+    }
+    report.white_wins = report.games - report.black_wins;
+    return report;
+}
+
+} // namespace
+
+template <int SIZE>
+RandomPolicy<SIZE>::RandomPolicy() : random(1) {
+    candidates.reserve(SIZE * SIZE);
+}
+
+template <int SIZE>
+void RandomPolicy<SIZE>::start_game(uint64_t seed) {
+    random = FastRandom(seed);
+}
+
+template <int SIZE>
+Position RandomPolicy<SIZE>::choose_move(const Game<SIZE>& game) {
+    const Board<SIZE>& board = game.get_board();
+    int color = game.get_current_player();
+    candidates.clear();
+    for (const auto& pos : board.get_valid_moves(color)) {
+        if (!board.is_eye(pos.x, pos.y, color) && game.is_valid_move(pos.x, pos.y)) {
+            candidates.push_back(pos);
+        }
+    }
+    if (candidates.empty()) {
+        return Position(-1, -1);
+    }
+    return candidates[random.below((uint32_t)candidates.size())];
+}
+
+template <int SIZE>
+PatternPolicy<SIZE>::PatternPolicy(const PatternWeights& weights) : weights(weights), random(1) {
+    candidates.reserve(SIZE * SIZE);
+    cumulative.reserve(SIZE * SIZE);
+}
+
+template <int SIZE>
+void PatternPolicy<SIZE>::start_game(uint64_t seed) {
+    random = FastRandom(seed);
+}
+
+template <int SIZE>
+Position PatternPolicy<SIZE>::choose_move(const Game<SIZE>& game) {
+    const Board<SIZE>& board = game.get_board();
+    int color = game.get_current_player();
+    candidates.clear();
+    cumulative.clear();
+    float total = 0;
+    for (const auto& pos : board.get_valid_moves(color)) {
+        if (!board.is_eye(pos.x, pos.y, color) && game.is_valid_move(pos.x, pos.y)) {
+            total += weights.get(board.get_pattern(pos.x, pos.y), color);
+            candidates.push_back(pos);
+            cumulative.push_back(total);
+        }
+    }
+    if (candidates.empty()) {
+        return Position(-1, -1);
+    }
+    float target = (float)((random.next() >> 40) * (1.0 / (1 << 24))) * total;
+    size_t i = std::upper_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin();
+    return candidates[std::min(i, candidates.size() - 1)];
+}
+
+template <int SIZE>
+SearchPolicy<SIZE>::SearchPolicy(const SearchConfig& config) : config(config) {}
+
+template <int SIZE>
+void SearchPolicy<SIZE>::start_game(uint64_t seed) {
+    // A fresh search per game: nothing carries over between games
+    config.seed = seed;
+    search.reset(new MctsSearch<SIZE>(config));
+}
+
+template <int SIZE>
+Position SearchPolicy<SIZE>::choose_move(const Game<SIZE>& game) {
+    return search->search(game).best_move;
+}
+
+SelfPlayReport run_self_play(const SelfPlayConfig& config, GameRecordWriter* records) {
+    return dispatch_board_size(config.board_size, [&](auto board_size) {
+        return run_batch<decltype(board_size)::value>(config, records);
+    });
+}
+
+template class RandomPolicy<9>;
+template class RandomPolicy<13>;
+template class RandomPolicy<19>;
+template class PatternPolicy<9>;
+template class PatternPolicy<13>;
+template class PatternPolicy<19>;
+template class SearchPolicy<9>;
+template class SearchPolicy<13>;
+template class SearchPolicy<19>;
@@ -0,0 +1,120 @@
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include "game.h"
+#include "game_record.h"
+#include "mcts.h"
+#include "ownership.h"
+#include "pattern.h"
+#include "playout.h"
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// Chooses the moves of a self-play game. Each worker thread owns its own
+// policy, so implementations need no locking.
+template <int SIZE>
+class MovePolicy {
+public:
+    virtual ~MovePolicy() = default;
+
+    // Called before each game with that game's seed
+    virtual void start_game(uint64_t seed) = 0;
+    // Move for the player to move, (-1, -1) to pass
+    virtual Position choose_move(const Game<SIZE>& game) = 0;
+};
+
+// Uniformly random legal moves that do not fill the mover's own eyes, as
+// in the playouts; passes when there are none
+template <int SIZE>
+class RandomPolicy : public MovePolicy<SIZE> {
+private:
+    FastRandom random;
+    std::vector<Position> candidates;
+
+public:
+    RandomPolicy();
+
+    void start_game(uint64_t seed) override;
+    Position choose_move(const Game<SIZE>& game) override;
+};
+
+// Single-threaded tree search with a fixed number of playouts per move,
+// so games are reproducible from their seed
+template <int SIZE>
+class SearchPolicy : public MovePolicy<SIZE> {
+private:
+    SearchConfig config;
+    std::unique_ptr<MctsSearch<SIZE>> search;
+
+public:
+    explicit SearchPolicy(const SearchConfig& config);
+
+    void start_game(uint64_t seed) override;
+    Position choose_move(const Game<SIZE>& game) override;
+};
+
+// Random moves like RandomPolicy, but each candidate is drawn with
+// probability proportional to the weight of its 3x3 pattern
+template <int SIZE>
+class PatternPolicy : public MovePolicy<SIZE> {
+private:
+    const PatternWeights& weights;
+    FastRandom random;
+    std::vector<Position> candidates;
+    std::vector<float> cumulative;
+
+public:
+    explicit PatternPolicy(const PatternWeights& weights = PatternWeights::heuristic());
+
+    void start_game(uint64_t seed) override;
+    Position choose_move(const Game<SIZE>& game) override;
+};
+
+enum class PolicyKind {
+    Random,
+    Pattern,
+    Search
+};
+
+struct SelfPlayConfig {
+    int games = 100;
+    int threads = 0;             // 0 uses every hardware thread
+    int board_size = DEFAULT_BOARD_SIZE;
+    uint64_t seed = 1;           // game i is played with a seed derived from seed and i
+    double komi = 7.5;
+    int max_moves = 0;           // move cap per game, passes included; 0 is 3 * size^2
+    bool pin_threads = false;    // pin worker i to CPU i modulo the CPU count
+    PolicyKind policy = PolicyKind::Random;
+    long long playouts = 1000;   // per move, for PolicyKind::Search
+    // End a game once estimate_final_score is at least this sure of the
+    // winner, checked every size moves from move size^2 / 2 on; 0 plays
+    // every game out
+    double resolve_confidence = 0;
+    int resolve_playouts = 64;   // playouts per estimate
+};
+
+struct SelfPlayWorkerStats {
+    int games;
+    long long moves;             // passes included
+    double seconds;
+    bool pinned;
+};
+
+struct SelfPlayReport {
+    int games;
+    long long moves;
+    int black_wins;
+    int white_wins;
+    int resolved;                // games ended early by resolve_confidence
+    double seconds;
+    std::vector<SelfPlayWorkerStats> workers;
+};
+
+// Plays config.games games on a pool of worker threads. Workers take the
+// next game number from a shared counter and write each finished game to
+// records (when given) as soon as it ends, so records arrive out of order
+// but every game depends only on its own seed.
+SelfPlayReport run_self_play(const SelfPlayConfig& config, GameRecordWriter* records);
+
+#endif // SELFPLAY_H
@@ -0,0 +1,145 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include "selfplay.h"
+#include "sgf.h"
+
+namespace {
+
+void print_usage() {
+    std::cerr << "Usage: GoSelfPlay [--games N] [--threads N] [--size 9|13|19] [--seed N]\n"
+                 "                  [--policy random|pattern|search] [--playouts N] [--komi K]\n"
+                 "                  [--max-moves N] [--resolve CONFIDENCE] [--resolve-playouts N]\n"
+                 "                  [--out FILE] [--sgf FILE] [--pin]" << std::endl;
+}
+
+} // namespace
+
+// Headless batch self-play: plays --games games on a pool of worker threads
+// and writes them as a game record stream (see game_record.h) to --out
+// and as an SGF collection to --sgf.
+// The same --seed gives the same games whatever the thread count; only the
+// order of the records changes.
+int main(int argc, char** argv) {
+    SelfPlayConfig config;
+    std::string out_path;
+    std::string sgf_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--pin") {
+            config.pin_threads = true;
+            continue;
+        }
+        if (!value) {
+            print_usage();
+            return 1;
+        }
+        i++;
+        if (arg == "--games") {
+            config.games = std::atoi(value);
+        } else if (arg == "--threads") {
+            config.threads = std::atoi(value);
+        } else if (arg == "--size") {
+            config.board_size = std::atoi(value);
+        } else if (arg == "--seed") {
+            config.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--policy" && std::strcmp(value, "random") == 0) {
+            config.policy = PolicyKind::Random;
+        } else if (arg == "--policy" && std::strcmp(value, "pattern") == 0) {
+            config.policy = PolicyKind::Pattern;
+        } else if (arg == "--policy" && std::strcmp(value, "search") == 0) {
+            config.policy = PolicyKind::Search;
+        } else if (arg == "--playouts") {
+            config.playouts = std::atoll(value);
+        } else if (arg == "--komi") {
+            config.komi = std::atof(value);
+        } else if (arg == "--max-moves") {
+            config.max_moves = std::atoi(value);
+        } else if (arg == "--resolve") {
+            config.resolve_confidence = std::atof(value);
+        } else if (arg == "--resolve-playouts") {
+            config.resolve_playouts = std::atoi(value);
+        } else if (arg == "--out") {
+            out_path = value;
+        } else if (arg == "--sgf") {
+            sgf_path = value;
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (config.games <= 0 || config.threads < 0 || config.playouts <= 0 || config.max_moves < 0 ||
+        config.resolve_confidence < 0 || config.resolve_playouts <= 0 ||
+        !is_supported_board_size(config.board_size)) {
+        print_usage();
+        return 1;
+    }
+    
+    // SGF is written afterwards from the records, kept in memory when
+    // there is no --out file to read them back from
+    std::ofstream out;
+    std::stringstream buffer;
+    std::unique_ptr<GameRecordWriter> records;
+    if (!out_path.empty()) {
+        out.open(out_path, std::ios::binary);
+        if (!out) {
+            std::cerr << "Cannot write " << out_path << std::endl;
+            return 1;
+        }
+        records.reset(new GameRecordWriter(out));
+    } else if (!sgf_path.empty()) {
+        records.reset(new GameRecordWriter(buffer));
+    }
+    
+    SelfPlayReport report = run_self_play(config, records.get());
+    
+    for (size_t i = 0; i < report.workers.size(); i++) {
+        const SelfPlayWorkerStats& worker = report.workers[i];
+        double seconds = worker.seconds > 0 ? worker.seconds : 1e-9;
+        std::cout << "worker " << i << (worker.pinned ? " (pinned)" : "") << ": " << worker.games
+                  << " games, " << worker.games / seconds << " games/s, "
+                  << (long long)(worker.moves / seconds) << " moves/s, average length "
+                  << (worker.games ? (double)worker.moves / worker.games : 0.0) << std::endl;
+    }
+    double seconds = report.seconds > 0 ? report.seconds : 1e-9;
+    std::cout << report.games << " games on " << config.board_size << "x" << config.board_size
+              << " in " << report.seconds << " s: " << report.games / seconds << " games/s, "
+              << (long long)(report.moves / seconds) << " moves/s, average length "
+              << (double)report.moves / report.games << std::endl;
+    std::cout << "black " << report.black_wins << " wins, white " << report.white_wins
+              << " wins (komi " << config.komi << ")" << std::endl;
+    if (config.resolve_confidence > 0) {
+        std::cout << report.resolved << " games ended early and scored by estimate" << std::endl;
+    }
+    
+    if (out.is_open()) {
+        out.flush();
+        if (!out) {
+            std::cerr << "Error writing " << out_path << std::endl;
+            return 1;
+        }
+        out.close();
+    }
+    if (!sgf_path.empty()) {
+        std::ifstream saved;
+        if (!out_path.empty()) {
+            saved.open(out_path, std::ios::binary);
+        }
+        GameRecordReader reader(out_path.empty() ? (std::istream&)buffer : saved);
+        std::ofstream sgf_out(sgf_path, std::ios::binary);
+        SgfWriter writer(sgf_out);
+        GameRecord record;
+        while (reader.read(record)) {
+            writer.write(to_sgf(record));
+        }
+        if (!sgf_out) {
+            std::cerr << "Error writing " << sgf_path << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,378 @@
+#include "sgf.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// Stands in for a point value that is not two letters; no board has it,
+// so replaying the move fails instead of the whole file
+const Position BAD_POINT(64, 64);
+
+bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+bool is_upper(char c) {
+    return c >= 'A' && c <= 'Z';
+}
+
+bool is_lower(char c) {
+    return c >= 'a' && c <= 'z';
+}
+
+// FF[4] coordinates: a-z are 0-25, A-Z are 26-51
+int decode_coordinate(char c) {
+    if (is_lower(c)) {
+        return c - 'a';
+    }
+    if (is_upper(c)) {
+        return c - 'A' + 26;
+    }
+    return -1;
+}
+
+Position decode_point(const char* value, const char* value_end) {
+    if (value_end - value != 2) {
+        return BAD_POINT;
+    }
+    int x = decode_coordinate(value[0]);
+    int y = decode_coordinate(value[1]);
+    return x < 0 || y < 0 ? BAD_POINT : Position(x, y);
+}
+
+// Leading number of a value, ignoring anything after it ("6.5", " 19 ")
+double decode_number(const char* value, const char* value_end) {
+    while (value < value_end && is_space(*value)) {
+        value++;
+    }
+    bool negative = value < value_end && *value == '-';
+    if (value < value_end && (*value == '-' || *value == '+')) {
+        value++;
+    }
+    double number = 0;
+    while (value < value_end && *value >= '0' && *value <= '9') {
+        number = number * 10 + (*value++ - '0');
+    }
+    if (value < value_end && *value == '.') {
+        value++;
+        for (double scale = 0.1; value < value_end && *value >= '0' && *value <= '9'; scale /= 10) {
+            number += (*value++ - '0') * scale;
+        }
+    }
+    return negative ? -number : number;
+}
+
+// Point list values may be single points or FF[4] rectangles "aa:cc"
+void decode_point_list(const char* value, const char* value_end, std::vector<Position>& points) {
+    if (value_end - value == 5 && value[2] == ':') {
+        Position a = decode_point(value, value + 2);
+        Position b = decode_point(value + 3, value_end);
+        if (a == BAD_POINT || b == BAD_POINT) {
+            points.push_back(BAD_POINT);
+            return;
+        }
+        for (int y = std::min(a.y, b.y); y <= std::max(a.y, b.y); y++) {
+            for (int x = std::min(a.x, b.x); x <= std::max(a.x, b.x); x++) {
+                points.push_back(Position(x, y));
+            }
+        }
+        return;
+    }
+    points.push_back(decode_point(value, value_end));
+}
+
+std::string unescape(const char* value, const char* value_end) {
+    std::string text;
+    for (; value < value_end; value++) {
+        if (*value == '\\' && value + 1 < value_end) {
+            value++;
+        }
+        text += *value;
+    }
+    return text;
+}
+
+void write_point(std::ostream& out, const Position& point) {
+    out << '[' << (char)('a' + point.x) << (char)('a' + point.y) << ']';
+}
+
+// Property identifiers as a number: "B" is 'B', "AB" is 'A' << 8 | 'B'.
+// Lower-case letters, which FF[3] allowed inside identifiers, are dropped.
+constexpr int property(const char* name) {
+    return name[1] ? name[0] << 8 | name[1] : name[0];
+}
+
+} // namespace
+
+void SgfGame::clear() {
+    board_size = 19;
+    komi = 0;
+    result.clear();
+    first_player = EMPTY;
+    black_setup.clear();
+    white_setup.clear();
+    moves.clear();
+    later_setup = false;
+}
+
+SgfReader::SgfReader(const char* data, size_t size) : pos(data), end(data + size), start(data) {}
+
+void SgfReader::fail(const char* message) {
+    error = std::string(message) + " at byte " + std::to_string(pos - start);
+    pos = end;
+}
+
+bool SgfReader::skip_value() {
+    // pos is on the opening bracket; a backslash escapes the next character
+    for (pos++; pos < end; pos++) {
+        if (*pos == '\\') {
+            pos++;
+        } else if (*pos == ']') {
+            pos++;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SgfReader::next(SgfGame& game) {
+    game.clear();
+    // Text between game trees is ignored, as the standard allows
+    while (pos < end && *pos != '(') {
+        pos++;
+    }
+    if (pos == end) {
+        return false;
+    }
+    
+    // The main line is the first variation at every branch: once a
+    // main-line tree closes, everything else in its parent is a side line
+    int depth = 0;
+    int main_depth = 0;
+    bool main_open = true;
+    bool on_main = false;
+    bool in_root = false;
+    int nodes = 0;
+    while (pos < end) {
+        char c = *pos;
+        if (c == '(') {
+            depth++;
+            if (main_open && depth == main_depth + 1) {
+                main_depth = depth;
+            }
+            pos++;
+        } else if (c == ')') {
+            if (depth == main_depth) {
+                main_open = false;
+            }
+            depth--;
+            pos++;
+            if (depth == 0) {
+                if (game.first_player == EMPTY) {
+                    game.first_player = game.moves.empty() ? BLACK : game.moves.front().color;
+                }
+                return true;
+            }
+        } else if (c == ';') {
+            on_main = main_open && depth == main_depth;
+            in_root = on_main && nodes == 0;
+            nodes += on_main ? 1 : 0;
+            pos++;
+        } else if (is_upper(c) || is_lower(c)) {
+            int id = 0;
+            int length = 0;
+            for (; pos < end && (is_upper(*pos) || is_lower(*pos)); pos++) {
+                if (is_upper(*pos)) {
+                    id = id << 8 | *pos;
+                    length++;
+                }
+            }
+            while (pos < end && is_space(*pos)) {
+                pos++;
+            }
+            if (pos == end || *pos != '[') {
+                fail("property without a value");
+                return false;
+            }
+            if (length > 2 || !on_main) {
+                id = 0;
+            }
+            while (pos < end && *pos == '[') {
+                const char* value = pos + 1;
+                if (!skip_value()) {
+                    fail("unterminated property value");
+                    return false;
+                }
+                const char* value_end = pos - 1;
+                switch (id) {
+                case property("B"):
+                case property("W"): {
+                    Position point(-1, -1);
+                    bool tt_pass = game.board_size <= 19 && value_end - value == 2 && value[0] == 't' && value[1] == 't';
+                    if (value_end > value && !tt_pass) {
+                        point = decode_point(value, value_end);
+                    }
+                    game.moves.push_back(SgfMove{id == 'B' ? BLACK : WHITE, point});
+                    break;
+                }
+                case property("AB"):
+                case property("AW"):
+                case property("AE"):
+                    if (!in_root) {
+                        game.later_setup = true;
+                    } else if (id != property("AE")) {
+                        decode_point_list(value, value_end, id == property("AB") ? game.black_setup : game.white_setup);
+                    }
+                    break;
+                case property("SZ"):
+                    if (in_root) {
+                        // Rectangular boards are written "19:13"
+                        const char* colon = std::find(value, value_end, ':');
+                        int columns = (int)decode_number(value, colon);
+                        bool square = colon == value_end || (int)decode_number(colon + 1, value_end) == columns;
+                        game.board_size = square ? columns : 0;
+                    }
+                    break;
+                case property("KM"):
+                    if (in_root) {
+                        game.komi = decode_number(value, value_end);
+                    }
+                    break;
+                case property("RE"):
+                    if (in_root) {
+                        game.result = unescape(value, value_end);
+                    }
+                    break;
+                case property("PL"):
+                    if (in_root && value_end > value) {
+                        game.first_player = *value == 'W' || *value == 'w' ? WHITE : BLACK;
+                    }
+                    break;
+                default:
+                    break;
+                }
+                while (pos < end && is_space(*pos)) {
+                    pos++;
+                }
+            }
+        } else if (is_space(c)) {
+            pos++;
+        } else {
+            fail("unexpected character");
+            return false;
+        }
+    }
+    fail("unterminated game tree");
+    return false;
+}
+
+bool SgfReader::next_span(const char*& begin, const char*& span_end) {
+    while (pos < end && *pos != '(') {
+        pos++;
+    }
+    if (pos == end) {
+        return false;
+    }
+    begin = pos;
+    int depth = 0;
+    while (pos < end) {
+        char c = *pos;
+        if (c == '[') {
+            if (!skip_value()) {
+                fail("unterminated property value");
+                return false;
+            }
+            continue;
+        }
+        pos++;
+        if (c == '(') {
+            depth++;
+        } else if (c == ')' && --depth == 0) {
+            span_end = pos;
+            return true;
+        }
+    }
+    fail("unterminated game tree");
+    return false;
+}
+
+const std::string& SgfReader::get_error() const {
+    return error;
+}
+
+SgfWriter::SgfWriter(std::ostream& out) : out(out) {}
+
+void SgfWriter::write(const SgfGame& game) {
+    out << "(;GM[1]FF[4]CA[UTF-8]SZ[" << game.board_size << "]KM[" << game.komi << "]";
+    if (!game.result.empty()) {
+        out << "RE[";
+        for (char c : game.result) {
+            if (c == ']' || c == '\\') {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << "]";
+    }
+    if (!game.black_setup.empty()) {
+        out << "AB";
+        for (const auto& point : game.black_setup) {
+            write_point(out, point);
+        }
+    }
+    if (!game.white_setup.empty()) {
+        out << "AW";
+        for (const auto& point : game.white_setup) {
+            write_point(out, point);
+        }
+    }
+    if (game.first_player == WHITE) {
+        out << "PL[W]";
+    }
+    for (size_t i = 0; i < game.moves.size(); i++) {
+        if (i % 10 == 0) {
+            out << '\n';
+        }
+        const SgfMove& move = game.moves[i];
+        out << (move.color == BLACK ? ";B" : ";W");
+        if (move.point.x < 0) {
+            out << "[]";
+        } else {
+            write_point(out, move.point);
+        }
+    }
+    out << ")\n";
+}
+
+SgfGame to_sgf(const GameRecord& record) {
+    SgfGame game;
+    game.clear();
+    game.board_size = record.board_size;
+    game.komi = record.komi;
+    game.first_player = record.white_first ? WHITE : BLACK;
+    for (int16_t point : record.black_setup) {
+        game.black_setup.push_back(Position(point % record.board_size, point / record.board_size));
+    }
+    for (int16_t point : record.white_setup) {
+        game.white_setup.push_back(Position(point % record.board_size, point / record.board_size));
+    }
+    
+    // Games stopped at the move cap have no result
+    double margin = record.black_score - record.white_score - record.komi;
+    std::ostringstream result;
+    if (record.move_limit) {
+        result << "?";
+    } else if (margin == 0) {
+        result << "0";
+    } else {
+        result << (margin > 0 ? "B+" : "W+") << (margin > 0 ? margin : -margin);
+    }
+    game.result = result.str();
+    
+    for (size_t i = 0; i < record.moves.size(); i++) {
+        int16_t move = record.moves[i];
+        Position point = move < 0 ? Position(-1, -1) : Position(move % record.board_size, move / record.board_size);
+        game.moves.push_back(SgfMove{i % 2 == 0 ? game.first_player : get_opponent(game.first_player), point});
+    }
+    return game;
+}
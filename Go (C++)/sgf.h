@@ -0,0 +1,71 @@
+#ifndef SGF_H
+#define SGF_H
+
+#include "board.h"
+#include "game_record.h"
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+struct SgfMove {
+    int color;                 // BLACK or WHITE
+    Position point;            // (-1, -1) for a pass
+};
+
+// The main line of one SGF game tree: the root properties the engine
+// understands and the moves of the first variation at every branch
+struct SgfGame {
+    int board_size;            // SZ, 19 when absent, 0 when not square
+    double komi;               // KM, 0 when absent
+    std::string result;        // RE, empty when absent
+    int first_player;          // PL, else the color of the first move, else BLACK
+    std::vector<Position> black_setup;   // AB and AW in the root node
+    std::vector<Position> white_setup;
+    std::vector<SgfMove> moves;
+    bool later_setup;          // AB, AW or AE after the root: not replayable
+
+    void clear();
+};
+
+// Reads the game trees of an SGF collection one at a time from a block of
+// memory (usually a MappedFile), without copying it. Property values are
+// scanned in place; only the ones above are decoded, and side variations,
+// comments and markup are skipped over.
+class SgfReader {
+private:
+    const char* pos;
+    const char* end;
+    const char* start;
+    std::string error;
+
+    void fail(const char* message);
+    bool skip_value();
+
+public:
+    SgfReader(const char* data, size_t size);
+
+    // Decodes the next game tree into game. False at the end of the input
+    // or on malformed input, which get_error() then describes.
+    bool next(SgfGame& game);
+    // Finds the bytes of the next game tree without decoding them, so a
+    // collection can be split up and decoded in parallel
+    bool next_span(const char*& begin, const char*& span_end);
+    const std::string& get_error() const;
+};
+
+class SgfWriter {
+private:
+    std::ostream& out;
+
+public:
+    explicit SgfWriter(std::ostream& out);
+
+    // Writes one game tree; a collection is several in a row
+    void write(const SgfGame& game);
+};
+
+// The SGF form of a game record, with RE from its final score
+SgfGame to_sgf(const GameRecord& record);
+
+#endif // SGF_H
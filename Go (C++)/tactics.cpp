@@ -0,0 +1,274 @@
+#include "tactics.h"
+#include <algorithm>
+
+namespace {
+
+// Mixed into the board hash so the cache tells apart the different
+// questions asked about one position
+constexpr uint64_t ATTACK_KEY = 0x9E3779B97F4A7C15ULL;
+constexpr uint64_t DEFEND_KEY = 0xBF58476D1CE4E5B9ULL;
+constexpr uint64_t RACE_KEYS[2] = {0x94D049BB133111EBULL, 0xD6E8FEB86659FD93ULL};
+constexpr uint64_t PASSED_KEY = 0xA0761D6478BD642FULL;
+
+constexpr int DX[4] = {-1, 1, 0, 0};
+constexpr int DY[4] = {0, 0, -1, 1};
+
+// Moves a capture race may consider: both chains' liberties and the
+// captures of up to MAX_CAPTURES chains in atari
+constexpr int MAX_CAPTURES = 8;
+
+} // namespace
+
+template <int SIZE>
+TacticalReader<SIZE>::TacticalReader(int max_nodes)
+    : board(nullptr), max_nodes(max_nodes), nodes(0), exhausted(false), query(0), undo_depth(0) {
+    for (auto& entry : cache) {
+        entry = CacheEntry{0, 0, 0};
+    }
+    group.reserve(SIZE * SIZE);
+}
+
+template <int SIZE>
+void TacticalReader<SIZE>::begin_query(Board<SIZE>& target_board) {
+    board = &target_board;
+    nodes = 0;
+    exhausted = false;
+    undo_depth = 0;
+    // Bumping the query number empties the cache without touching it
+    if (++query == 0) {
+        for (auto& entry : cache) {
+            entry.query = 0;
+        }
+        query = 1;
+    }
+}
+
+template <int SIZE>
+bool TacticalReader<SIZE>::play(Position move, int color) {
+    if (!board->is_valid_move(move.x, move.y, color)) {
+        return false;
+    }
+    if (undo_depth == (int)undo_stack.size()) {
+        undo_stack.emplace_back();
+    }
+    Undo& entry = undo_stack[undo_depth++];
+    entry.move = move;
+    entry.captured.clear();
+    entry.ko = board->get_ko();
+    entry.last_move = board->get_last_move();
+    board->make_move(move.x, move.y, color, &entry.captured);
+    return true;
+}
+
+template <int SIZE>
+void TacticalReader<SIZE>::undo() {
+    Undo& entry = undo_stack[--undo_depth];
+    board->undo_move(entry.move.x, entry.move.y, entry.captured, entry.ko, entry.last_move);
+}
+
+template <int SIZE>
+bool TacticalReader<SIZE>::spend_node() {
+    if (nodes >= max_nodes) {
+        exhausted = true;
+        return false;
+    }
+    nodes++;
+    return true;
+}
+
+template <int SIZE>
+bool TacticalReader<SIZE>::lookup(uint64_t key, int& value) const {
+    const CacheEntry& entry = cache[key % CACHE_SIZE];
+    if (entry.query == query && entry.key == key) {
+        value = entry.value;
+        return true;
+    }
+    return false;
+}
+
+template <int SIZE>
+void TacticalReader<SIZE>::store(uint64_t key, int value) {
+    // A result read with a cut-off search may be wrong, so it is not kept
+    if (!exhausted) {
+        cache[key % CACHE_SIZE] = CacheEntry{key, query, (int8_t)value};
+    }
+}
+
+template <int SIZE>
+int TacticalReader<SIZE>::atari_captures(Position chain, Position* moves, int count) {
+    int color = board->get(chain.x, chain.y);
+    int opponent = get_opponent(color);
+    group.clear();
+    board->get_group(chain.x, chain.y, group);
+    int added = 0;
+    for (const auto& stone : group) {
+        for (int i = 0; i < 4 && added < MAX_CAPTURES; i++) {
+            int x = stone.x + DX[i];
+            int y = stone.y + DY[i];
+            Position liberties[2];
+            if (board->get(x, y) == opponent && board->get_liberties(x, y, 2, liberties) == 1 &&
+                std::find(moves, moves + count, liberties[0]) == moves + count) {
+                moves[count++] = liberties[0];
+                added++;
+            }
+        }
+    }
+    return count;
+}
+
+template <int SIZE>
+bool TacticalReader<SIZE>::attack_ladder(Position target, int depth) {
+    int attacker = get_opponent(board->get(target.x, target.y));
+    Position liberties[3];
+    int count = board->get_liberties(target.x, target.y, 3, liberties);
+    if (count == 1) {
+        return board->is_valid_move(liberties[0].x, liberties[0].y, attacker);
+    }
+    if (count >= 3) {
+        return false;
+    }
+    if (depth <= 0) {
+        exhausted = true;
+        return false;
+    }
+    uint64_t key = board->get_hash() ^ ATTACK_KEY;
+    int value;
+    if (lookup(key, value)) {
+        return value != 0;
+    }
+    
+    // Only ataris keep a ladder going
+    bool captured = false;
+    for (int i = 0; i < 2 && !captured && spend_node(); i++) {
+        if (!play(liberties[i], attacker)) {
+            continue;
+        }
+        Position left[2];
+        if (board->get_liberties(target.x, target.y, 2, left) == 1) {
+            captured = !defend_ladder(target, depth - 1);
+        }
+        undo();
+    }
+    store(key, captured);
+    return captured;
+}
+
+template <int SIZE>
+bool TacticalReader<SIZE>::defend_ladder(Position target, int depth) {
+    int defender = board->get(target.x, target.y);
+    uint64_t key = board->get_hash() ^ DEFEND_KEY;
+    int value;
+    if (lookup(key, value)) {
+        return value != 0;
+    }
+    
+    // Extend from the liberties, or capture a stone that is giving atari
+    Position moves[2 + MAX_CAPTURES];
+    int count = board->get_liberties(target.x, target.y, 2, moves);
+    count = atari_captures(target, moves, count);
+    bool escaped = false;
+    for (int i = 0; i < count && !escaped; i++) {
+        if (!spend_node()) {
+            escaped = true;
+            break;
+        }
+        if (!play(moves[i], defender)) {
+            continue;
+        }
+        escaped = !attack_ladder(target, depth - 1);
+        undo();
+    }
+    store(key, escaped);
+    return escaped;
+}
+
+template <int SIZE>
+int TacticalReader<SIZE>::race(Position own, Position their, int color, int depth, bool passed) {
+    if (!spend_node()) {
+        return 0;
+    }
+    int opponent = get_opponent(color);
+    Position their_liberties[RACE_LIBERTIES + 1];
+    int theirs = board->get_liberties(their.x, their.y, RACE_LIBERTIES + 1, their_liberties);
+    if (theirs == 1 && board->is_valid_move(their_liberties[0].x, their_liberties[0].y, color)) {
+        return 1;
+    }
+    Position own_liberties[RACE_LIBERTIES + 1];
+    int ours = board->get_liberties(own.x, own.y, RACE_LIBERTIES + 1, own_liberties);
+    if (theirs > RACE_LIBERTIES || ours > RACE_LIBERTIES || depth <= 0) {
+        exhausted = true;
+        return 0;
+    }
+    uint64_t key = board->get_hash() ^ RACE_KEYS[color - 1] ^ (passed ? PASSED_KEY : 0);
+    int value;
+    if (lookup(key, value)) {
+        return value;
+    }
+    
+    // Filling their liberties first finds the usual winning line soonest
+    Position moves[2 * RACE_LIBERTIES + MAX_CAPTURES];
+    int count = std::copy(their_liberties, their_liberties + theirs, moves) - moves;
+    for (int i = 0; i < ours; i++) {
+        if (std::find(moves, moves + count, own_liberties[i]) == moves + count) {
+            moves[count++] = own_liberties[i];
+        }
+    }
+    count = atari_captures(own, moves, count);
+    
+    int best = -1;
+    for (int i = 0; i < count && best < 1; i++) {
+        if (!play(moves[i], color)) {
+            continue;
+        }
+        value = board->get(their.x, their.y) == EMPTY ? 1 : -race(their, own, opponent, depth - 1, false);
+        undo();
+        best = std::max(best, value);
+    }
+    // Passing is a move too; two in a row leave both chains standing
+    if (best < 1) {
+        best = std::max(best, passed ? 0 : -race(their, own, opponent, depth - 1, true));
+    }
+    store(key, best);
+    return best;
+}
+
+template <int SIZE>
+bool TacticalReader<SIZE>::is_ladder_captured(Board<SIZE>& target_board, int x, int y, int to_move) {
+    begin_query(target_board);
+    int color = target_board.get(x, y);
+    Position liberties[3];
+    if ((color != BLACK && color != WHITE) || target_board.get_liberties(x, y, 3, liberties) >= 3) {
+        return false;
+    }
+    // A ladder runs at most across the board and back in both directions
+    constexpr int depth = 4 * SIZE;
+    Position target(x, y);
+    return to_move == color ? !defend_ladder(target, depth) : attack_ladder(target, depth);
+}
+
+template <int SIZE>
+int TacticalReader<SIZE>::capture_race(Board<SIZE>& target_board, Position a, Position b, int to_move) {
+    begin_query(target_board);
+    int color_a = target_board.get(a.x, a.y);
+    int color_b = target_board.get(b.x, b.y);
+    if ((color_a != BLACK && color_a != WHITE) || color_b != get_opponent(color_a) ||
+        (to_move != BLACK && to_move != WHITE)) {
+        return RACE_UNKNOWN;
+    }
+    Position own = color_a == to_move ? a : b;
+    Position their = color_a == to_move ? b : a;
+    int value = race(own, their, to_move, 4 * RACE_LIBERTIES, false);
+    if (exhausted) {
+        return RACE_UNKNOWN;
+    }
+    return value > 0 ? to_move : value < 0 ? get_opponent(to_move) : EMPTY;
+}
+
+template <int SIZE>
+int TacticalReader<SIZE>::get_nodes() const {
+    return nodes;
+}
+
+template class TacticalReader<9>;
+template class TacticalReader<13>;
+template class TacticalReader<19>;
@@ -0,0 +1,78 @@
+#ifndef TACTICS_H
+#define TACTICS_H
+
+#include "board.h"
+#include <vector>
+#include <cstdint>
+
+// Capture race outcome when it is not read out within the reader's budget
+constexpr int RACE_UNKNOWN = -1;
+
+// Depth- and node-limited tactical reading: ladders and capture races.
+// Queries play moves on the caller's board with make_move/undo_move and
+// leave it as they found it. Liberties come from Board::get_liberties,
+// which stops as soon as it has the few it needs, and positions already
+// read in the current query are answered from a small hash cache.
+template <int SIZE>
+class TacticalReader {
+private:
+    struct CacheEntry {
+        uint64_t key;
+        uint32_t query;        // the query that stored it; older entries are stale
+        int8_t value;
+    };
+    
+    struct Undo {
+        Position move;
+        std::vector<Position> captured;
+        std::optional<Position> ko;
+        std::optional<Position> last_move;
+    };
+    
+    static constexpr int CACHE_SIZE = 256;
+    static constexpr int RACE_LIBERTIES = 6;    // longer races are not read
+    
+    Board<SIZE>* board;
+    int max_nodes;
+    int nodes;
+    bool exhausted;                    // the budget ran out during this query
+    uint32_t query;
+    CacheEntry cache[CACHE_SIZE];
+    std::vector<Undo> undo_stack;
+    int undo_depth;
+    std::vector<Position> group;
+    
+    bool play(Position move, int color);
+    void undo();
+    bool spend_node();
+    bool lookup(uint64_t key, int& value) const;
+    void store(uint64_t key, int value);
+    int atari_captures(Position chain, Position* moves, int count);
+    
+    bool attack_ladder(Position target, int depth);
+    bool defend_ladder(Position target, int depth);
+    int race(Position own, Position their, int color, int depth, bool passed);
+    void begin_query(Board<SIZE>& board);
+
+public:
+    // max_nodes bounds the moves played per query, so the worst case cost
+    // of a query is known up front
+    explicit TacticalReader(int max_nodes = 1000);
+    
+    // True if the chain at (x, y), with at most two liberties, is captured
+    // in a ladder: the attacker keeps it in atari until it has no escape,
+    // while the defender extends or captures an atari-ing stone.
+    // to_move is the color to move. Budget exhaustion counts as escaping.
+    bool is_ladder_captured(Board<SIZE>& board, int x, int y, int to_move);
+    
+    // Reads the capture race between the adjacent chains at a and b (of
+    // opposite colors) with to_move moving first. Returns the color whose
+    // chain survives, EMPTY for seki, or RACE_UNKNOWN when a chain has too
+    // many liberties or the budget runs out.
+    int capture_race(Board<SIZE>& board, Position a, Position b, int to_move);
+    
+    // Moves played by the last query
+    int get_nodes() const;
+};
+
+#endif // TACTICS_H
@@ -0,0 +1,110 @@
+#include "transposition.h"
+#include "board.h"
+
+namespace {
+
+// XORed into the board hash when White is to move, as in Game
+constexpr uint64_t WHITE_TO_MOVE_KEY = 0x8F1BBCDCCA62C1D6ULL;
+
+// Slots must fit in 32 bits below NO_REF's
+constexpr size_t MAX_BUCKETS = size_t(1) << 29;
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t megabytes) : hits(0), misses(0), collisions(0) {
+    size_t wanted = (megabytes << 20) / sizeof(Bucket);
+    size_t count = 1;
+    while (count * 2 <= wanted && count * 2 <= MAX_BUCKETS) {
+        count *= 2;
+    }
+    buckets.reset(new Bucket[count]);
+    bucket_mask = count - 1;
+    clear();
+}
+
+uint64_t TranspositionTable::key(uint64_t board_hash, int to_move) {
+    uint64_t result = to_move == WHITE ? board_hash ^ WHITE_TO_MOVE_KEY : board_hash;
+    // 0 marks an empty entry
+    return result ? result : 1;
+}
+
+uint64_t TranspositionTable::probe(uint64_t key) {
+    uint32_t first_slot = (uint32_t)(key & bucket_mask) * BUCKET_ENTRIES;
+    uint64_t check = key >> 32;
+    Bucket& bucket = buckets[key & bucket_mask];
+    
+    for (;;) {
+        int victim = 0;
+        uint64_t victim_key = 0;
+        uint64_t victim_visits = UINT64_MAX;
+        for (int i = 0; i < BUCKET_ENTRIES; i++) {
+            uint64_t entry_key = bucket.entries[i].key.load(std::memory_order_acquire);
+            if (entry_key == key) {
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return check << 32 | (first_slot + i);
+            }
+            // Empty entries have no visits, so they are taken first
+            uint64_t visits = bucket.entries[i].data.load(std::memory_order_relaxed) >> 32;
+            if (entry_key == 0) {
+                visits = 0;
+            }
+            if (visits < victim_visits) {
+                victim = i;
+                victim_key = entry_key;
+                victim_visits = visits;
+            }
+        }
+        
+        // Another thread may claim the same entry first; then look again,
+        // since it may have been claimed for this very position
+        Entry& claimed = bucket.entries[victim];
+        if (claimed.key.compare_exchange_strong(victim_key, key, std::memory_order_acq_rel)) {
+            claimed.data.store(0, std::memory_order_relaxed);
+            misses.fetch_add(1, std::memory_order_relaxed);
+            if (victim_key != 0) {
+                collisions.fetch_add(1, std::memory_order_relaxed);
+            }
+            return check << 32 | (first_slot + victim);
+        }
+    }
+}
+
+bool TranspositionTable::read(uint64_t ref, TranspositionStats& stats) const {
+    const Entry& e = entry((uint32_t)ref);
+    if (e.key.load(std::memory_order_relaxed) >> 32 != ref >> 32) {
+        return false;
+    }
+    uint64_t data = e.data.load(std::memory_order_relaxed);
+    stats.visits = (int)(data >> 32);
+    stats.wins = (int)(uint32_t)data;
+    return true;
+}
+
+void TranspositionTable::update(uint64_t ref, bool win) {
+    Entry& e = entry((uint32_t)ref);
+    if (e.key.load(std::memory_order_relaxed) >> 32 != ref >> 32) {
+        return;
+    }
+    // wins never exceed visits, so the low word cannot carry into the high
+    e.data.fetch_add((uint64_t(1) << 32) | (win ? 1 : 0), std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (size_t b = 0; b <= bucket_mask; b++) {
+        for (auto& e : buckets[b].entries) {
+            e.key.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    hits.store(0);
+    misses.store(0);
+    collisions.store(0);
+}
+
+TranspositionCounters TranspositionTable::get_counters() const {
+    return TranspositionCounters{hits.load(), misses.load(), collisions.load()};
+}
+
+size_t TranspositionTable::get_entry_count() const {
+    return (bucket_mask + 1) * BUCKET_ENTRIES;
+}
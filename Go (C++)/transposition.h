@@ -0,0 +1,76 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+struct TranspositionStats {
+    int visits;
+    int wins;        // for the player who moved into the position
+};
+
+struct TranspositionCounters {
+    uint64_t hits;          // probes that found their position
+    uint64_t misses;        // probes that had to claim an entry
+    uint64_t collisions;    // misses that evicted another position
+};
+
+// Search statistics per position, shared by every path that reaches it.
+// Keys are the board hash with the side to move mixed in. The table is a
+// fixed array of 64-byte buckets holding four entries each; a position can
+// only live in the bucket its key selects, and a miss in a full bucket
+// evicts the entry with the fewest visits.
+//
+// Nothing is locked. An entry is claimed with a compare-and-swap on its key
+// and its visits and wins share one 64-bit word, so an update is a single
+// fetch_add. Callers keep the slot probe() returned together with the key's
+// check bits and pass both back; once the entry has been taken by another
+// position, reads fail and updates are dropped. An update racing with an
+// eviction can land on the new position; the statistics only steer the
+// search, so that is tolerated.
+class TranspositionTable {
+public:
+    static constexpr int BUCKET_ENTRIES = 4;
+    
+    // Reference to a claimed entry: slot in the low word, the key's check
+    // bits in the high word. NO_REF is never a valid reference.
+    static constexpr uint64_t NO_REF = UINT64_MAX;
+    
+    // megabytes is rounded down to a power of two buckets, at least one
+    explicit TranspositionTable(size_t megabytes);
+    
+    static uint64_t key(uint64_t board_hash, int to_move);
+    
+    // Find the entry for key, claiming one if the position is new
+    uint64_t probe(uint64_t key);
+    bool read(uint64_t ref, TranspositionStats& stats) const;
+    void update(uint64_t ref, bool win);
+    
+    void clear();
+    TranspositionCounters get_counters() const;
+    size_t get_entry_count() const;
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> key;      // 0 marks an empty entry
+        std::atomic<uint64_t> data;     // visits << 32 | wins
+    };
+    
+    struct alignas(64) Bucket {
+        Entry entries[BUCKET_ENTRIES];
+    };
+    
+    std::unique_ptr<Bucket[]> buckets;
+    uint64_t bucket_mask;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> collisions;
+    
+    Entry& entry(uint32_t slot) const {
+        return buckets[slot / BUCKET_ENTRIES].entries[slot % BUCKET_ENTRIES];
+    }
+};
+
+#endif // TRANSPOSITION_H